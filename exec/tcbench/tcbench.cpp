@@ -0,0 +1,726 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+//! @file
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#define TCDECLARE_OBJECT
+#include "tctype.h"
+#include "tcfield.h"
+#include "tcmovegen.h"
+#include "tcpiece.h"
+#include "tcplayer.h"
+#include "tcplayfield.h"
+#include "tcpos.h"
+#include "tcrandomgenerator.h"
+#include "tcstringlist.h"
+#include "tcevent.h"
+#include "../../player/atplayer1/atu.h"
+
+static const char	*g_strRuleOpt = "W=10&H=18";
+static size_t		g_Count = 200;
+
+
+
+//----------------------------------------------------------------------------
+void	PrintCopyright()
+{
+	std::cerr
+		<< "tcbench "
+		<< "(build: "
+		<< __DATE__ << " " << __TIME__
+		<< "), Copyright (c) Abe Chanta"
+		<< std::endl
+		<< std::endl;
+
+} // end of PrintCopyright
+
+
+
+void	PrintUsage()
+{
+	std::cerr
+		<< "Usage:" << std::endl
+		<< "  tcbench.exe [-rule:<ruleopt>] [-count:<count>]" << std::endl
+		<< std::endl
+		<< "Option:" << std::endl
+		<< "  available ruleopt is: W=<4..62>, H=<4..30>" << std::endl
+		<< "    the field row is 16bit for W<=14, 32bit for W<=30, 64bit otherwise" << std::endl
+		<< "    IsSetPiece is also measured with the 32bit row for W<=14" << std::endl
+		<< "    default is '" << g_strRuleOpt << "'" << std::endl
+		<< "  count is the number of repetitions, default is " << g_Count << std::endl
+		<< std::endl;
+
+} // end of PrintUsage
+
+
+
+//----------------------------------------------------------------------------
+/*!
+	経過時間を計測するためのクラスです。
+*/
+class STOPWATCH
+{
+private:
+	LARGE_INTEGER	m_Freq;
+	LARGE_INTEGER	m_Start;
+
+public:
+	STOPWATCH()
+	{
+		QueryPerformanceFrequency(&m_Freq);
+		QueryPerformanceCounter(&m_Start);
+
+	} // end of STOPWATCH::ctor
+
+	double	GetSec() const
+	{
+		LARGE_INTEGER	Now;
+		QueryPerformanceCounter(&Now);
+		return static_cast<double>(Now.QuadPart - m_Start.QuadPart) / static_cast<double>(m_Freq.QuadPart);
+
+	} // end of STOPWATCH::GetSec
+};
+
+
+
+/*!
+	ベンチマークに使用するフィールドを生成します。
+	ランダムな位置にピースを落下させて、高さの異なるフィールドを作ります。
+	@param[in] Width フィールドの幅
+	@param[in] Height フィールドの高さ
+	@param[in] FieldCount 生成するフィールドの数
+	@return フィールドの配列
+*/
+template <typename FIELD>
+std::vector<FIELD>	MakeFields(int8_t Width, int8_t Height, size_t FieldCount)
+{
+	std::vector<FIELD>	Fields;
+	TCRANDOMGENERATOR	Random(1);	// 毎回同じフィールドを生成する
+
+	for (size_t ii = 0; ii < FieldCount; ii++) {
+		FIELD	Field(Width, Height);
+		Field.StartGame();
+
+		size_t	PieceCount = ii % (Field.GetSize().GetX() * Field.GetSize().GetY() / TCPIECE::PIECE_WIDTH / 2);
+		for (size_t jj = 0; jj < PieceCount; jj++) {
+			TCPIECE	Piece;
+			Piece.Randomize(Random, Field.GetSize());
+			Piece.m_Rot = static_cast<uint8_t>(Random.Get() % TCPIECE::ROT_MAX);
+			Piece = Piece.MoveY(Piece.GetTopOfsY() - 1);	// -1 is for frame
+			Piece = Piece.MoveX(static_cast<int8_t>(static_cast<ssize_t>(Random.Get() % Width) - Width / 2));
+			if (!Field.IsSetPiece(Piece)) {
+				break;
+			}
+			while (Field.IsSetPiece(Piece.MoveY(-1))) {
+				Piece = Piece.MoveY(-1);
+			}
+			Field.SetPiece(Piece);
+			Field.RemoveLines(Field.GetLinesMask(Piece));
+		}
+		Fields.push_back(Field);
+	}
+	return Fields;
+
+} // end of MakeFields
+
+
+
+/*!
+	フィールド内のすべての位置に、すべての形状・回転状態のピースを配置できるか判定します。
+	@param[in] Fields フィールドの配列
+	@param[in] bPacked true なら IsSetPiece_Packed、false なら IsSetPiece_Loop を使用する
+	@param[out] Probes 判定した回数
+	@return 配置できた回数（カーネル間の結果比較用）
+*/
+template <typename FIELD>
+size_t	Bench_IsSetPiece(const std::vector<FIELD> &Fields, bool bPacked, size_t &Probes)
+{
+	size_t	Value = 0;
+	Probes = 0;
+	for (size_t cc = 0; cc < g_Count; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			for (uint8_t Fig = 0; Fig < TCPIECE::FIG_MAX; Fig++) {
+				for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+					TCPIECE	Piece(Fig, Rot, TCPOS(0, 0));
+					for (int8_t yy = -1; yy < it->GetSize().GetY(); yy++) {
+						for (int8_t xx = TCPIECE::MASK_POS_X_MIN; xx < it->GetSize().GetX(); xx++) {
+							bool	bSet = bPacked ? it->IsSetPiece_Packed(Piece, TCPOS(xx, yy)) : it->IsSetPiece_Loop(Piece, TCPOS(xx, yy));
+							Value += bSet ? 1 : 0;
+							Probes++;
+						}
+					}
+				}
+			}
+		}
+	}
+	return Value;
+
+} // end of Bench_IsSetPiece
+
+/*!
+	フィールドの上端から、すべての X 位置に、すべての形状・回転状態のピースを落下させたときの着地位置を求めます。
+	@param[in] Fields フィールドの配列
+	@param[in] bDropY true なら TCFIELD::GetDropY でまとめて、false なら X 位置ごとに ATU::LimitD で求める
+	@param[out] Sweeps 全 X 位置分を求めた回数
+	@return 着地位置の合計（実装間の結果比較用）
+*/
+template <typename FIELD>
+size_t	Bench_Drop(const std::vector<FIELD> &Fields, bool bDropY, size_t &Sweeps)
+{
+	size_t	Value = 0;
+	Sweeps = 0;
+	for (size_t cc = 0; cc < g_Count; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			for (uint8_t Fig = 0; Fig < TCPIECE::FIG_MAX; Fig++) {
+				for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+					TCPIECE	Piece(Fig, Rot, TCPOS(0, it->GetSize().GetY() - 2 + TCPIECE::GetTopOfsY(Fig, Rot)));
+					int8_t	DropY[FIELD::DROP_COUNT];
+					if (bDropY) {
+						it->GetDropY(Piece, DropY);
+					} else {
+						// ピースの最も右の列がフィールドの内側にある X 位置だけを調べる（GetDropY と同じ範囲）
+						const uint32_t	*pMask = TCPIECE::GetMask(Fig, Rot, 0);
+						int8_t	OfsX = static_cast<int8_t>(TCBIT::FindLowest(pMask[0] | pMask[1] | pMask[2] | pMask[3]));
+						for (size_t ii = 0; ii < FIELD::DROP_COUNT; ii++) {
+							int8_t	xx = static_cast<int8_t>(TCPIECE::MASK_POS_X_MIN + ii);
+							TCPIECE	Target = Piece.MoveX(xx);
+							bool	bInside = (xx + OfsX >= 1) && (xx + OfsX <= it->GetSize().GetX() - 2);
+							DropY[ii] = (bInside && it->IsSetPiece(Target)) ? ATU::LimitD(*it, Target).m_Pos.GetY() : FIELD::DROP_NONE;
+						}
+					}
+					for (int8_t xx = 1; xx < it->GetSize().GetX() - 1; xx++) {
+						Value += (DropY[xx - TCPIECE::MASK_POS_X_MIN] != FIELD::DROP_NONE) ? DropY[xx - TCPIECE::MASK_POS_X_MIN] : 0;
+					}
+					Sweeps++;
+				}
+			}
+		}
+	}
+	return Value;
+
+} // end of Bench_Drop
+
+/*!
+	フィールドの上端に現れたピースについて、固めることができる位置を TCMOVEGEN ですべて列挙します。
+	@param[in] Fields フィールドの配列
+	@param[out] Calls 列挙した回数
+	@return 列挙した配置の数の合計
+*/
+template <typename FIELD>
+size_t	Bench_MoveGen(const std::vector<FIELD> &Fields, size_t &Calls)
+{
+	TCMOVEGENT<typename FIELD::ROW>	MoveGen;
+	size_t	Value = 0;
+	Calls = 0;
+	for (size_t cc = 0; cc < g_Count; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			for (uint8_t Fig = 0; Fig < TCPIECE::FIG_MAX; Fig++) {
+				TCPIECE	Piece(Fig, 0, TCPOS((it->GetSize().GetX() - TCPIECE::PIECE_WIDTH) / 2, it->GetSize().GetY() - 1));
+				if (Fig == TCPIECE::FIG_I) {
+					Piece = Piece.MoveY(-1);
+				}
+				Value += MoveGen.Generate(*it, Piece, true);
+				Calls++;
+			}
+		}
+	}
+	return Value;
+
+} // end of Bench_MoveGen
+
+
+
+/*!
+	ピースの出現時に回転させ、そのまま真下に落とした位置を配置として返すプレイヤです（Bench_PlacementPath 用）。
+	重力が大きいと、落下を始める前（TCEVENT_PREP）に回転しなければ間に合わない配置になります。
+	次のピースの出現時に、返した配置で固まったかどうかを数えます。
+*/
+class SPAWNROTPLAYER : public TCPLAYER
+{
+public:
+	TCFIELD		m_Before;		//!< 配置を返したときのフィールド
+	TCPIECE		m_Target;		//!< 返した配置
+	bool		m_bTarget;		//!< 配置を返したかどうか
+	size_t		m_Placed;		//!< 返した配置の数
+	size_t		m_Missed;		//!< 返した配置で固まらなかった数
+
+	SPAWNROTPLAYER(int8_t Width, int8_t Height)
+		: TCPLAYER("", "", 0),
+		m_Before(Width, Height),
+		m_Target(),
+		m_bTarget(false),
+		m_Placed(0),
+		m_Missed(0)
+	{
+	} // end of SPAWNROTPLAYER::ctor
+
+	const char	*GetName() const { return "spawnrot"; }
+	const char	*GetAuthor() const { return "tcbench"; }
+	void	StartGame(const TCFIELD &Field) { m_bTarget = false; }
+	void	EndGame(const TCSCORE &Score) { m_bTarget = false; }
+	TCEVENT	Exec(TCEVENT Event, const TCFIELD &Field, const TCPIECE &CtrlPiece, const TCPIECE &NextPiece) { return 0; }
+	bool	IsStationary() const { return true; }
+
+	bool	GetPlacement(TCEVENT Event, const TCFIELD &Field, const TCPIECE &CtrlPiece, const TCPIECE &NextPiece, TCPIECE &Target)
+	{
+		if (m_bTarget) {
+			TCFIELD	Expected(m_Before);
+			Expected.MakeMove(m_Target);
+			m_Missed += (Expected.GetHash() == Field.GetHash()) ? 0 : 1;
+			m_bTarget = false;
+		}
+
+		// 左回転と右回転を交互に使う
+		TCPIECE	Piece = CtrlPiece.Rotate((m_Placed % 2) ? -1 : +1);
+		Piece = Piece.MoveY(Piece.GetTopOfsY());
+		if (!Field.IsSetPiece(Piece)) {
+			return false;
+		}
+		while (Field.IsSetPiece(Piece.MoveY(-1))) {
+			Piece = Piece.MoveY(-1);
+		}
+
+		m_Before = Field;
+		m_Target = Piece;
+		m_bTarget = true;
+		m_Placed++;
+		Target = Piece;
+		return true;
+
+	} // end of SPAWNROTPLAYER::GetPlacement
+};
+
+/*!
+	ゲーム側が、プレイヤが返した配置までの入力を探索して固めるまでを、実際のゲーム進行で計測します。
+	配置は出現時の回転が必要なもの（SPAWNROTPLAYER）なので、探索が落下開始前の回転を扱えているかも確かめます。
+	@param[in] Width フィールドの幅
+	@param[in] Height フィールドの高さ
+	@param[in] Gravity 重力係数
+	@param[out] Placed 返した配置の数
+	@return 返した配置で固まらなかった数（0 であるべき）
+*/
+size_t	Bench_PlacementPath(int8_t Width, int8_t Height, size_t Gravity, size_t &Placed)
+{
+	SPAWNROTPLAYER	Player(Width, Height);
+	for (uint32_t seed = 1; seed <= (g_Count + 9) / 10; seed++) {
+		TCPLAYFIELD	PlayField(Width, Height, Gravity);
+		PlayField.StartGame(TCRANDOMGENERATOR(seed), &Player);
+		while (PlayField.IsPlaying()) {
+			PlayField.Tick(&Player);
+		}
+	}
+	Placed = Player.m_Placed;
+	return Player.m_Missed;
+
+} // end of Bench_PlacementPath
+
+
+
+/*!
+	組み込み命令を使う前の TCBIT::Count と同じく、１ビットずつ On ビットを数えます（比較用）。
+	@param[in] bitmap 入力とする数値
+	@param[in] width 入力とする数値のビット幅
+	@return On ビットの数
+*/
+size_t	CountBit_Loop(uint64_t bitmap, size_t width)
+{
+	size_t	rv = 0;
+	for (size_t ii = 0; ii < width; ii++) {
+		rv += (bitmap & 0x00000001U) ? 1 : 0;
+		bitmap >>= 1;
+	}
+	return rv;
+
+} // end of CountBit_Loop
+
+/*!
+	組み込み命令を使う前の ATU::CountBit と同じく、５ビットずつ表を引いて On ビットを数えます（比較用）。
+	@param[in] bitmap 入力とする数値
+	@param[in] width 入力とする数値のビット幅
+	@return On ビットの数
+*/
+size_t	CountBit_Table(uint64_t bitmap, size_t width)
+{
+	static const size_t	BitCount[32] = {
+		0+0,	0+1,	0+1,	0+2,	0+1,	0+2,	0+2,	0+3,
+		1+0,	1+1,	1+1,	1+2,	1+1,	1+2,	1+2,	1+3,
+		1+0,	1+1,	1+1,	1+2,	1+1,	1+2,	1+2,	1+3,
+		2+0,	2+1,	2+1,	2+2,	2+1,	2+2,	2+2,	2+3,
+	};
+
+	size_t	rv = 0;
+	for (size_t ii = 0; ii < width; ii += 5) {
+		rv += BitCount[bitmap & 0x0000001FU];
+		bitmap >>= 5;
+	}
+	return rv;
+
+} // end of CountBit_Table
+
+/*!
+	CountSpots の実装の種類です。
+*/
+enum COUNTSPOTS_MODE
+{
+	COUNTSPOTS_SCAN_LOOP,		//!< フィールドを走査し、１ビットずつ数える（以前の TCFIELD::CountSpots）
+	COUNTSPOTS_SCAN_PORTABLE,	//!< フィールドを走査し、TCBIT::Count_Portable で数える
+	COUNTSPOTS_SCAN_INTRINSIC,	//!< フィールドを走査し、TCBIT::Count で数える
+	COUNTSPOTS_CACHED,			//!< TCFIELD::CountSpots（差分で更新している値を返す）
+};
+
+/*!
+	フィールドのスポット数を数えます。
+	@param[in] Fields フィールドの配列
+	@param[in] Mode 実装の種類
+	@param[out] Calls 数えた回数
+	@return スポット数の合計（実装間の結果比較用）
+*/
+template <typename FIELD>
+size_t	Bench_CountSpots(const std::vector<FIELD> &Fields, COUNTSPOTS_MODE Mode, size_t &Calls)
+{
+	size_t	Value = 0;
+	Calls = 0;
+	for (size_t cc = 0; cc < g_Count * 100; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			if (Mode == COUNTSPOTS_CACHED) {
+				Value += it->CountSpots();
+				Calls++;
+				continue;
+			}
+
+			typename FIELD::ROW	mask = 0;
+			for (int8_t yy = it->GetSize().GetY() - 2; yy >= 1; yy--) {
+				typename FIELD::ROW	bitmap = it->GetBitmap(yy) & it->GetLineFilled();
+				uint64_t			spots = static_cast<typename FIELD::ROW>(~bitmap & mask);
+				switch (Mode) {
+				case COUNTSPOTS_SCAN_LOOP:
+					Value += CountBit_Loop(spots, it->GetSize().GetX());
+					break;
+				case COUNTSPOTS_SCAN_PORTABLE:
+					Value += TCBIT::Count_Portable(static_cast<uint32_t>(spots)) + TCBIT::Count_Portable(static_cast<uint32_t>(spots >> 32));
+					break;
+				default:
+					Value += FIELD::BIT::Count(static_cast<typename FIELD::ROW>(spots));
+					break;
+				}
+				mask |= bitmap;
+			}
+			Calls++;
+		}
+	}
+	return Value;
+
+} // end of Bench_CountSpots
+
+/*!
+	フィールドの段ごとのスポット数を求めます。
+	@param[in] Fields フィールドの配列
+	@param[in] bCached true なら ATU::GetSpots、false なら以前の ATU::GetSpots と同じくフィールドを走査する
+	@param[out] Calls 求めた回数
+	@return スポット数の合計（実装間の結果比較用）
+*/
+template <typename FIELD>
+size_t	Bench_GetSpots(const std::vector<FIELD> &Fields, bool bCached, size_t &Calls)
+{
+	size_t	Value = 0;
+	Calls = 0;
+	for (size_t cc = 0; cc < g_Count * 10; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			std::vector<int8_t>	Spots;
+			if (bCached) {
+				Spots = ATU::GetSpots(*it);
+			} else {
+				Spots.resize(it->GetSize().GetY());
+				typename FIELD::ROW	BlockFoundMask = 0;
+				for (int8_t yy = it->GetSize().GetY() - 2; yy >= 1; yy--) {
+					typename FIELD::ROW	Bitmap = it->GetBitmap(yy) & it->GetLineFilled();
+					Spots[yy] = static_cast<int8_t>(CountBit_Table(static_cast<typename FIELD::ROW>(~Bitmap & BlockFoundMask), it->GetSize().GetX()));
+					BlockFoundMask |= Bitmap;
+				}
+			}
+			for (size_t yy = 0; yy < Spots.size(); yy++) {
+				Value += Spots[yy];
+			}
+			Calls++;
+		}
+	}
+	return Value;
+
+} // end of Bench_GetSpots
+
+/*!
+	各列の最も上のスポットより上にあるブロック数（ATU::GetSpotHeight）を求める速度を計測します。
+	@param[in] Fields 計測に使うフィールド
+	@param[in] bColumn true なら ATU::GetSpotHeight、false なら以前の ATU::GetSpotHeight と同じく各段を走査する
+	@param[out] Calls 求めた回数
+	@return ブロック数の合計（実装間の結果比較用）
+*/
+template <typename FIELD>
+size_t	Bench_GetSpotHeight(const std::vector<FIELD> &Fields, bool bColumn, size_t &Calls)
+{
+	typedef typename FIELD::ROW	ROW;
+	size_t	Value = 0;
+	Calls = 0;
+	for (size_t cc = 0; cc < g_Count * 10; cc++) {
+		for (typename std::vector<FIELD>::const_iterator it = Fields.begin(); it != Fields.end(); ++it) {
+			std::vector<int8_t>	SpotHeight;
+			if (bColumn) {
+				SpotHeight = ATU::GetSpotHeight(*it);
+			} else {
+				SpotHeight.resize(it->GetSize().GetX());
+				ROW		BlockFoundMask = 0;
+				ROW		SpotFoundMask = 0;
+				for (int8_t yy = it->GetSize().GetY() - 2; yy >= 1; yy--) {
+					ROW		Bitmap = static_cast<ROW>(it->GetBitmap(yy) & it->GetLineFilled() & ~SpotFoundMask);
+					for (; Bitmap; Bitmap &= Bitmap - 1) {
+						SpotHeight[FIELD::BIT::FindLowest(Bitmap)]++;
+					}
+					BlockFoundMask |= it->GetBitmap(yy) & it->GetLineFilled();
+					SpotFoundMask |= ~it->GetBitmap(yy) & it->GetLineFilled() & BlockFoundMask;
+				}
+				for (ROW Bitmap = static_cast<ROW>(~SpotFoundMask & it->GetLineFilled()); Bitmap; Bitmap &= Bitmap - 1) {
+					SpotHeight[FIELD::BIT::FindLowest(Bitmap)] = 0;
+				}
+			}
+			for (size_t xx = 0; xx < SpotHeight.size(); xx++) {
+				Value += SpotHeight[xx];
+			}
+			Calls++;
+		}
+	}
+	return Value;
+
+} // end of Bench_GetSpotHeight
+
+
+
+/*!
+	ベンチマークの結果を出力します。
+	@param[in] strName ベンチマーク名
+	@param[in] Sec 経過時間（秒）
+	@param[in] Count 処理した回数
+	@param[in] Check 結果比較用の値
+*/
+void	PrintResult(const char *strName, double Sec, size_t Count, size_t Check)
+{
+	std::cout
+		<< std::setw(28) << std::left << strName << std::right
+		<< std::setw(10) << std::fixed << std::setprecision(3) << (Sec * 1000.0) << " ms  "
+		<< std::setw(8) << std::fixed << std::setprecision(2) << (Sec * 1000000000.0 / static_cast<double>(Count)) << " ns/op  "
+		<< "(check=" << Check << ")"
+		<< std::endl;
+
+} // end of PrintResult
+
+
+
+/*!
+	ベンチマークの条件（フィールドの大きさと１段の型）を表示します。
+	@param[in] Width フィールドの幅
+	@param[in] Height フィールドの高さ
+*/
+template <typename FIELD>
+void	PrintHeader(int8_t Width, int8_t Height)
+{
+	std::cout
+		<< "W=" << static_cast<ssize_t>(Width) << "&H=" << static_cast<ssize_t>(Height)
+		<< ", row=" << FIELD::BIT::BITS << "bit"
+		<< ", count=" << g_Count
+		<< std::endl;
+
+} // end of PrintHeader
+
+
+
+/*!
+	IsSetPiece の２つのカーネル（Loop と Packed）を計測します。
+	@param[in] Fields フィールドの配列
+*/
+template <typename FIELD>
+void	RunBench_IsSetPiece(const std::vector<FIELD> &Fields)
+{
+	{
+		size_t	Probes = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_IsSetPiece(Fields, false, Probes);
+		PrintResult("IsSetPiece_Loop", Watch.GetSec(), Probes, Check);
+	}
+	{
+		size_t	Probes = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_IsSetPiece(Fields, true, Probes);
+		PrintResult("IsSetPiece_Packed", Watch.GetSec(), Probes, Check);
+	}
+
+} // end of RunBench_IsSetPiece
+
+
+
+/*!
+	すべてのベンチマークを実行します。
+	@param[in] Width フィールドの幅
+	@param[in] Height フィールドの高さ
+*/
+template <typename FIELD>
+void	RunBench(int8_t Width, int8_t Height)
+{
+	std::vector<FIELD>	Fields = MakeFields<FIELD>(Width, Height, 64);
+
+	PrintHeader<FIELD>(Width, Height);
+	RunBench_IsSetPiece(Fields);
+
+	{
+		size_t	Sweeps = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_Drop(Fields, false, Sweeps);
+		PrintResult("Drop(LimitD per x)", Watch.GetSec(), Sweeps, Check);
+	}
+	{
+		size_t	Sweeps = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_Drop(Fields, true, Sweeps);
+		PrintResult("Drop(GetDropY)", Watch.GetSec(), Sweeps, Check);
+	}
+	{
+		size_t	Calls = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_MoveGen(Fields, Calls);
+		PrintResult("MoveGen(PREP)", Watch.GetSec(), Calls, Check);
+	}
+
+	{
+		static const struct {
+			const char		*strName;
+			COUNTSPOTS_MODE	Mode;
+		} BenchTbl[] = {
+			{ "CountSpots(scan,loop)",		COUNTSPOTS_SCAN_LOOP, },
+			{ "CountSpots(scan,portable)",	COUNTSPOTS_SCAN_PORTABLE, },
+			{ "CountSpots(scan,intrinsic)",	COUNTSPOTS_SCAN_INTRINSIC, },
+			{ "CountSpots(cached)",			COUNTSPOTS_CACHED, },
+		};
+		for (size_t ii = 0; ii < sizeof(BenchTbl) / sizeof(BenchTbl[0]); ii++) {
+			size_t	Calls = 0;
+			STOPWATCH	Watch;
+			size_t	Check = Bench_CountSpots(Fields, BenchTbl[ii].Mode, Calls);
+			PrintResult(BenchTbl[ii].strName, Watch.GetSec(), Calls, Check);
+		}
+	}
+
+	{
+		size_t	Calls = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_GetSpots(Fields, false, Calls);
+		PrintResult("ATU::GetSpots(scan)", Watch.GetSec(), Calls, Check);
+	}
+	{
+		size_t	Calls = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_GetSpots(Fields, true, Calls);
+		PrintResult("ATU::GetSpots(cached)", Watch.GetSec(), Calls, Check);
+	}
+
+	{
+		size_t	Calls = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_GetSpotHeight(Fields, false, Calls);
+		PrintResult("ATU::GetSpotHeight(rows)", Watch.GetSec(), Calls, Check);
+	}
+	{
+		size_t	Calls = 0;
+		STOPWATCH	Watch;
+		size_t	Check = Bench_GetSpotHeight(Fields, true, Calls);
+		PrintResult("ATU::GetSpotHeight(columns)", Watch.GetSec(), Calls, Check);
+	}
+
+} // end of RunBench
+
+
+
+//----------------------------------------------------------------------------
+int main(int argc, const char *argv[])
+{
+	PrintCopyright();
+
+	for (ssize_t ii = 1; ii < argc; ii++) {
+		if (strncmp(argv[ii], "-rule:", strlen("-rule:")) == 0) {
+			g_strRuleOpt = &argv[ii][strlen("-rule:")];
+		} else if (strncmp(argv[ii], "-count:", strlen("-count:")) == 0) {
+			g_Count = strtoul(&argv[ii][strlen("-count:")], NULL, 10);
+		} else {
+			PrintUsage();
+			exit(1);
+		}
+	}
+
+	TCSTRINGLIST	RuleList(g_strRuleOpt);
+	int8_t	Width = static_cast<int8_t>(RuleList.GetInteger("W"));
+	int8_t	Height = static_cast<int8_t>(RuleList.GetInteger("H"));
+	TCASSERT(Width >= 4, "RuleOpt invalid.");
+	TCASSERT(Height >= 4, "RuleOpt invalid.");
+
+	// フィールドの１段の型は、幅に合わせてここで一度だけ決める
+	if (Width <= TCFIELD16::FIELD_WIDTH_MAX) {
+		RunBench<TCFIELD16>(Width, Height);
+	} else if (Width <= TCFIELD::FIELD_WIDTH_MAX) {
+		RunBench<TCFIELD>(Width, Height);
+	} else {
+		RunBench<TCFIELD64>(Width, Height);
+	}
+
+	// 16bit の段で計測したときは、プレイフィールドが使う 32bit の段（TCFIELD）の IsSetPiece も並べて計測する
+	if (Width <= TCFIELD16::FIELD_WIDTH_MAX) {
+		std::vector<TCFIELD>	Fields = MakeFields<TCFIELD>(Width, Height, 64);
+
+		std::cout << std::endl;
+		PrintHeader<TCFIELD>(Width, Height);
+		RunBench_IsSetPiece(Fields);
+	}
+
+	// プレイフィールドは TCFIELD で進行する
+	if (Width <= TCFIELD::FIELD_WIDTH_MAX) {
+		static const struct {
+			const char	*strName;
+			size_t		Gravity;
+		} BenchTbl[] = {
+			{ "PlacementPath(G=10)",	10, },
+			{ "PlacementPath(G=200)",	200, },
+		};
+		for (size_t ii = 0; ii < sizeof(BenchTbl) / sizeof(BenchTbl[0]); ii++) {
+			size_t	Placed = 0;
+			STOPWATCH	Watch;
+			size_t	Check = Bench_PlacementPath(Width, Height, BenchTbl[ii].Gravity, Placed);
+			PrintResult(BenchTbl[ii].strName, Watch.GetSec(), Placed, Check);
+			TCASSERT(Check == 0, "placement missed.");
+		}
+	}
+
+	return 0;
+
+} /* end of main */
@@ -36,6 +36,7 @@ static const char	*g_strRuleOpt = "RULE=LONGRUN&W=10&H=18&G=10&R=10";
 static const char	*g_strViewOpt = "W=79&H=25&S=1";
 static const char	*g_strReportDst = "http://localhost:8080/tetcon/RecordResult";
 static const char	*g_strReportKey = "0000000000000000";
+static const char	*g_strCorpusDst = NULL;
 
 
 
@@ -59,11 +60,13 @@ void	PrintUsage()
 	std::cerr
 		<< "Usage:" << std::endl
 		<< "  tetcon.exe [-rule:<ruleopt>] [-view:<viewopt>] [-report:<dest>] [-authkey:<authkey>] <playerdll> ..." << std::endl
+		<< "  tetcon.exe [-rule:<ruleopt>] -mkcorpus:<file>" << std::endl
 		<< std::endl
 		<< "Option:" << std::endl
-		<< "  available ruleopt is: RULE=LONGRUN, W=<4..30>, H=<4..30>, G=<1..200>, R=<1..>" << std::endl
+		<< "  available ruleopt is: RULE=LONGRUN, W=<4..30>, H=<4..30>, G=<1..200>, R=<1..>, SEED=<0..> (0: by time)" << std::endl
+		<< "    CORPUS=<file> plays the N-th piece sequence of the corpus file in round N" << std::endl
 		<< "    default is '" << g_strRuleOpt << "'" << std::endl
-		<< "  available viewopt is: W=<1..>, H=<1..>, S=<1..>" << std::endl
+		<< "  available viewopt is: W=<1..>, H=<1..>, S=<1..>, VIEW=<CONSOLE|NULL>, T=<1..> (threads, with VIEW=NULL), FF=<0|1> (fast-forward, with VIEW=NULL), BATCH=<0|1> (batched tick, with VIEW=NULL and T=1)" << std::endl
 		<< "    default is '" << g_strViewOpt << "'" << std::endl
 		<< "  available dest scheme is: http" << std::endl
 		<< "    default is '" << g_strReportDst << "'" << std::endl
@@ -95,6 +98,8 @@ int main(int argc, const char *argv[])
 				g_strReportDst = &argv[ii][strlen("-report:")];
 			} else if (strncmp(argv[ii], "-authkey:", strlen("-authkey:")) == 0) {
 				g_strReportKey = &argv[ii][strlen("-authkey:")];
+			} else if (strncmp(argv[ii], "-mkcorpus:", strlen("-mkcorpus:")) == 0) {
+				g_strCorpusDst = &argv[ii][strlen("-mkcorpus:")];
 			} else {
 				PrintUsage();
 				exit(1);
@@ -103,11 +108,22 @@ int main(int argc, const char *argv[])
 			Players.push_back(argv[ii]);
 		}
 	}
+	if (g_strCorpusDst) {
+		// ruleopt の SEED・R で実行したときのピース列を、コーパスに書き出す
+		TCGAMECONTROL_CON	ctrl(g_strRuleOpt, g_strViewOpt, g_strReportDst, g_strReportKey);
+		if (!ctrl.MakeCorpus(g_strCorpusDst)) {
+			std::cerr << "tetcon.exe: couldn't write " << g_strCorpusDst << std::endl;
+			exit(1);
+		}
+		return 0;
+	}
 	if (Players.size() == 0) {
 		PrintUsage();
 		exit(1);
 	}
 
+	size_t	FrameCount = 0;
+	size_t	PieceCount = 0;
 	DWORD	msStart = GetTickCount();
 	{
 		TCGAMECONTROL_CON	ctrl(g_strRuleOpt, g_strViewOpt, g_strReportDst, g_strReportKey);
@@ -115,6 +131,8 @@ int main(int argc, const char *argv[])
 			ctrl.AddPlayer(Players[ii]);
 		}
 		ctrl.Run();
+		FrameCount = ctrl.GetFrameCount();
+		PieceCount = ctrl.GetPieceCount();
 	}
 
 	DWORD	msEnd = GetTickCount();
@@ -126,6 +144,16 @@ int main(int argc, const char *argv[])
 		<< std::setw(2) << ((msEnd - msStart) / (1000)) % 60 << "s "
 		<< std::endl;
 
+	// 実行速度（ヘッドレスモードでは、ゲーム進行だけにかかった速度になる）
+	double	secElapsed = max(msEnd - msStart, 1) / 1000.0;
+	std::cerr
+		<< "tetcon.exe: "
+		<< FrameCount << " frames ("
+		<< static_cast<size_t>(FrameCount / secElapsed) << " frames/s), "
+		<< PieceCount << " pieces ("
+		<< static_cast<size_t>(PieceCount / secElapsed) << " pieces/s)"
+		<< std::endl;
+
 	return 0;
 
 } /* end of main */
@@ -31,10 +31,18 @@
 #include <vector>
 #define TCDECLARE_OBJECT
 #include "tcgamecontrol.h"
+#include "tcspool.h"
+#include "tctournament.h"
 
 static const char	*g_strRuleOpt = "RULE=LONGRUN&W=10&H=18&G=10&R=10";
 static const char	*g_strViewOpt = "W=79&H=25&S=1";
 static const char	*g_strReportDst = "tetcon_result_<yymmdd>_<hhmmss>.log";
+static const char	*g_strCorpusDst = NULL;
+static const char	*g_strSeeds = NULL;
+static const char	*g_strSpoolDir = NULL;
+static const char	*g_strWorkerDir = NULL;
+static const char	*g_strMergeDir = NULL;
+static const char	*g_strRequeueDir = NULL;
 
 
 
@@ -58,12 +66,24 @@ void	PrintUsage()
 	std::cerr
 		<< "Usage:" << std::endl
 		<< "  tetcon.exe [-rule:<ruleopt>] [-view:<viewopt>] [-report:<dest>] <playerdll> ..." << std::endl
+		<< "  tetcon.exe [-rule:<ruleopt>] -mkcorpus:<file>" << std::endl
+		<< "  tetcon.exe -tournament:<seeds> [-rule:<ruleopt> ...] [-view:<viewopt>] [-report:<dest>] <playerdll> ..." << std::endl
+		<< "  tetcon.exe -tournament:<seeds> [-rule:<ruleopt> ...] -spool:<dir> <playerdll> ..." << std::endl
+		<< "  tetcon.exe [-view:<viewopt>] -worker:<dir>" << std::endl
+		<< "  tetcon.exe [-report:<dest>] -merge:<dir>" << std::endl
+		<< "  tetcon.exe -requeue:<dir>" << std::endl
 		<< std::endl
 		<< "Option:" << std::endl
-		<< "  available ruleopt is: RULE=LONGRUN, W=<4..30>, H=<4..30>, G=<1..200>, R=<1..>" << std::endl
+		<< "  available ruleopt is: RULE=LONGRUN, W=<4..30>, H=<4..30>, G=<1..200>, R=<1..>, SEED=<0..> (0: by time)" << std::endl
+		<< "    CORPUS=<file> plays the N-th piece sequence of the corpus file in round N" << std::endl
 		<< "    default is '" << g_strRuleOpt << "'" << std::endl
-		<< "  available viewopt is: W=<1..>, H=<1..>, S=<1..>" << std::endl
+		<< "  available viewopt is: W=<1..>, H=<1..>, S=<1..>, VIEW=<CONSOLE|NULL>, T=<1..> (threads, with VIEW=NULL), FF=<0|1> (fast-forward, with VIEW=NULL), BATCH=<0|1> (batched tick, with VIEW=NULL and T=1)" << std::endl
 		<< "    default is '" << g_strViewOpt << "'" << std::endl
+		<< "  available seeds is: comma-separated list of <1..> or <first>-<last>" << std::endl
+		<< "    with -tournament, every -rule: is a parameter set and plays R rounds for each seed, on T=<0..> threads (0: all processors)" << std::endl
+		<< "  available dir is: a new spool folder shared by every worker (-spool: creates it)" << std::endl
+		<< "    -worker: runs units until none is left (invalid units go to failed), -merge: joins the finished units, -requeue: returns units of aborted workers" << std::endl
+		<< "    playerdll must be reachable by the same path from every worker" << std::endl
 		<< "  available dest scheme is: file" << std::endl
 		<< "    default is '" << g_strReportDst << "'" << std::endl
 		<< std::endl
@@ -71,6 +91,17 @@ void	PrintUsage()
 		<< "  > tetcon.exe myplayer1.dll myplayer2.dll myplayer3.dll" << std::endl
 		<< "  > tetcon.exe -rule:RULE=LONGRUN&W=10&H=18&G=10&R=1 myplayer1.dll" << std::endl
 		<< "  > tetcon.exe -view:W=79&H=24&S=5 myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL -rule:RULE=LONGRUN&W=10&H=18&G=10&R=1000 myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL&T=8 -rule:RULE=LONGRUN&W=10&H=18&G=10&R=1000 myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL&T=8&FF=1 -rule:RULE=LONGRUN&W=10&H=18&G=1&R=1000 myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL&BATCH=1 -rule:RULE=LONGRUN&W=10&H=18&G=1&R=100 myplayer1.dll myplayer1.dll myplayer1.dll myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL -rule:RULE=LONGRUN&W=10&H=18&G=10&R=100&SEED=1234 myplayer1.dll myplayer2.dll" << std::endl
+		<< "  > tetcon.exe -rule:RULE=LONGRUN&W=10&H=18&G=10&R=5000&SEED=1 -mkcorpus:suite.tcs" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL&T=8 -rule:RULE=LONGRUN&W=10&H=18&G=10&R=5000&CORPUS=suite.tcs myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -tournament:1-20 -rule:RULE=LONGRUN&W=10&H=18&G=10&R=50 -rule:RULE=LONGRUN&W=10&H=18&G=1&R=50 myplayer1.dll myplayer2.dll" << std::endl
+		<< "  > tetcon.exe -tournament:1-100 -rule:RULE=LONGRUN&W=10&H=18&G=10&R=50 -spool:\\\\server\\spool1 \\\\server\\bin\\myplayer1.dll" << std::endl
+		<< "  > tetcon.exe -view:VIEW=NULL&T=8 -worker:\\\\server\\spool1" << std::endl
+		<< "  > tetcon.exe -report:tetcon_result.log -merge:\\\\server\\spool1" << std::endl
 		<< "  > tetcon.exe -report:tetcon_result.log myplayer1.dll" << std::endl
 		<< std::endl;
 
@@ -84,14 +115,28 @@ int main(int argc, const char *argv[])
 	PrintCopyright();
 
 	std::vector<const char*>	Players;
+	std::vector<const char*>	RuleOpts;
 	for (ssize_t ii = 1; ii < argc; ii++) {
 		if (argv[ii][0] == '-') {
 			if (strncmp(argv[ii], "-rule:", strlen("-rule:")) == 0) {
 				g_strRuleOpt = &argv[ii][strlen("-rule:")];
+				RuleOpts.push_back(g_strRuleOpt);
+			} else if (strncmp(argv[ii], "-tournament:", strlen("-tournament:")) == 0) {
+				g_strSeeds = &argv[ii][strlen("-tournament:")];
+			} else if (strncmp(argv[ii], "-spool:", strlen("-spool:")) == 0) {
+				g_strSpoolDir = &argv[ii][strlen("-spool:")];
+			} else if (strncmp(argv[ii], "-worker:", strlen("-worker:")) == 0) {
+				g_strWorkerDir = &argv[ii][strlen("-worker:")];
+			} else if (strncmp(argv[ii], "-merge:", strlen("-merge:")) == 0) {
+				g_strMergeDir = &argv[ii][strlen("-merge:")];
+			} else if (strncmp(argv[ii], "-requeue:", strlen("-requeue:")) == 0) {
+				g_strRequeueDir = &argv[ii][strlen("-requeue:")];
 			} else if (strncmp(argv[ii], "-view:", strlen("-view:")) == 0) {
 				g_strViewOpt = &argv[ii][strlen("-view:")];
 			} else if (strncmp(argv[ii], "-report:", strlen("-report:")) == 0) {
 				g_strReportDst = &argv[ii][strlen("-report:")];
+			} else if (strncmp(argv[ii], "-mkcorpus:", strlen("-mkcorpus:")) == 0) {
+				g_strCorpusDst = &argv[ii][strlen("-mkcorpus:")];
 			} else {
 				PrintUsage();
 				exit(1);
@@ -100,11 +145,105 @@ int main(int argc, const char *argv[])
 			Players.push_back(argv[ii]);
 		}
 	}
+	if (g_strCorpusDst) {
+		// ruleopt の SEED・R で実行したときのピース列を、コーパスに書き出す
+		TCGAMECONTROL	ctrl(g_strRuleOpt, g_strViewOpt, g_strReportDst);
+		if (!ctrl.MakeCorpus(g_strCorpusDst)) {
+			std::cerr << "tetcon.exe: couldn't write " << g_strCorpusDst << std::endl;
+			exit(1);
+		}
+		return 0;
+	}
+	if (g_strWorkerDir) {
+		// スプールフォルダから、未実行のユニットがなくなるまで取得して実行する
+		TCSPOOL	spool(g_strWorkerDir);
+		DWORD	msStart = GetTickCount();
+		size_t	UnitCount = spool.Work(g_strViewOpt);
+		DWORD	msEnd = GetTickCount();
+
+		double	secElapsed = max(msEnd - msStart, 1) / 1000.0;
+		std::cerr
+			<< "tetcon.exe: "
+			<< UnitCount << " units ("
+			<< spool.GetFailedCount() << " failed), "
+			<< spool.GetJobCount() << " jobs ("
+			<< (spool.GetJobCount() / secElapsed) << " jobs/s), "
+			<< spool.GetFrameCount() << " frames ("
+			<< static_cast<size_t>(spool.GetFrameCount() / secElapsed) << " frames/s), "
+			<< spool.GetPieceCount() << " pieces ("
+			<< static_cast<size_t>(spool.GetPieceCount() / secElapsed) << " pieces/s)"
+			<< std::endl;
+		return 0;
+	}
+	if (g_strMergeDir) {
+		// 実行を終えたユニットの結果を連結する
+		TCSPOOL	spool(g_strMergeDir);
+		size_t	DoneCount = 0;
+		size_t	PendingCount = 0;
+		size_t	FailedCount = 0;
+		if (!spool.Merge(g_strReportDst, DoneCount, PendingCount, FailedCount)) {
+			std::cerr << "tetcon.exe: couldn't write " << g_strReportDst << std::endl;
+			exit(1);
+		}
+		std::cerr << "tetcon.exe: " << DoneCount << " units merged, " << PendingCount << " units pending, " << FailedCount << " units failed" << std::endl;
+		return 0;
+	}
+	if (g_strRequeueDir) {
+		// 中断したワーカのユニットを、未実行に戻す
+		TCSPOOL	spool(g_strRequeueDir);
+		std::cerr << "tetcon.exe: " << spool.Requeue() << " units requeued" << std::endl;
+		return 0;
+	}
 	if (Players.size() == 0) {
 		PrintUsage();
 		exit(1);
 	}
+	if (g_strSeeds) {
+		// プレイヤ × パラメタセット × シード × ラウンドのジョブを、すべて並列に実行する
+		TCTOURNAMENT	tour(g_strViewOpt, g_strReportDst);
+		if (!tour.AddSeeds(g_strSeeds)) {
+			std::cerr << "tetcon.exe: invalid seeds " << g_strSeeds << std::endl;
+			exit(1);
+		}
+		if (RuleOpts.size() == 0) {
+			RuleOpts.push_back(g_strRuleOpt);
+		}
+		if (g_strSpoolDir) {
+			// パラメタセット × シードのユニットを、スプールフォルダに登録するだけにする
+			TCSPOOL	spool(g_strSpoolDir);
+			if (!spool.Enqueue(RuleOpts, g_strSeeds, Players)) {
+				std::cerr << "tetcon.exe: couldn't create " << g_strSpoolDir << std::endl;
+				exit(1);
+			}
+			return 0;
+		}
+		for (size_t ii = 0; ii < RuleOpts.size(); ii++) {
+			tour.AddParams(RuleOpts[ii]);
+		}
+		for (size_t ii = 0; ii < Players.size(); ii++) {
+			tour.AddPlayer(Players[ii]);
+		}
+
+		DWORD	msStart = GetTickCount();
+		tour.Run();
+		DWORD	msEnd = GetTickCount();
 
+		double	secElapsed = max(msEnd - msStart, 1) / 1000.0;
+		std::cerr
+			<< "tetcon.exe: "
+			<< tour.GetJobCount() << " jobs ("
+			<< (tour.GetJobCount() / secElapsed) << " jobs/s, "
+			<< tour.GetFailedCount() << " failed), "
+			<< tour.GetFrameCount() << " frames ("
+			<< static_cast<size_t>(tour.GetFrameCount() / secElapsed) << " frames/s), "
+			<< tour.GetPieceCount() << " pieces ("
+			<< static_cast<size_t>(tour.GetPieceCount() / secElapsed) << " pieces/s)"
+			<< std::endl;
+		return 0;
+	}
+
+	size_t	FrameCount = 0;
+	size_t	PieceCount = 0;
 	DWORD	msStart = GetTickCount();
 	{
 		TCGAMECONTROL	ctrl(g_strRuleOpt, g_strViewOpt, g_strReportDst);
@@ -112,6 +251,8 @@ int main(int argc, const char *argv[])
 			ctrl.AddPlayer(Players[ii]);
 		}
 		ctrl.Run();
+		FrameCount = ctrl.GetFrameCount();
+		PieceCount = ctrl.GetPieceCount();
 	}
 
 	DWORD	msEnd = GetTickCount();
@@ -123,6 +264,16 @@ int main(int argc, const char *argv[])
 		<< std::setw(2) << ((msEnd - msStart) / (1000)) % 60 << "s "
 		<< std::endl;
 
+	// 実行速度（ヘッドレスモードでは、ゲーム進行だけにかかった速度になる）
+	double	secElapsed = max(msEnd - msStart, 1) / 1000.0;
+	std::cerr
+		<< "tetcon.exe: "
+		<< FrameCount << " frames ("
+		<< static_cast<size_t>(FrameCount / secElapsed) << " frames/s), "
+		<< PieceCount << " pieces ("
+		<< static_cast<size_t>(PieceCount / secElapsed) << " pieces/s)"
+		<< std::endl;
+
 	return 0;
 
 } /* end of main */
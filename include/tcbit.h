@@ -31,6 +31,28 @@
 #include "tctype.h"
 
 //----------------------------------------------------------------------------
+/*!
+	1 にすると、TCBIT の各関数がコンパイラ組み込みのビット演算命令（ビットスキャン・ポピュレーションカウント）を使用します。
+	0 にすると、どのコンパイラでも動作する汎用の実装（*_Portable）を使用します。
+	対応していないコンパイラでは、常に汎用の実装を使用します。
+*/
+#ifndef TCBIT_INTRINSICS
+#define TCBIT_INTRINSICS	1
+#endif
+
+/*!
+	1 にすると、Visual C++ で __popcnt 命令を使用します。
+	POPCNT 命令に対応していない CPU では動作しないため、既定では 0（汎用の実装）です。
+	gcc では、-mpopcnt などで POPCNT 命令が有効なときだけ __builtin_popcount を使用します（ライブラリ呼び出しになるのを避けるため）。
+*/
+#ifndef TCBIT_POPCNT
+#define TCBIT_POPCNT	0
+#endif
+
+#if TCBIT_INTRINSICS && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 /*!
 	ビット演算をまとめたクラスです。
 */
@@ -55,13 +77,7 @@ namespace TCBIT
 	*/
 	uint32_t	Get(size_t idx)
 	{
-		static const uint32_t	BitTbl[] = {
-			1U << 0,	1U << 1,	1U << 2,	1U << 3,	1U << 4,	1U << 5,	1U << 6,	1U << 7,
-			1U << 8,	1U << 9,	1U << 10,	1U << 11,	1U << 12,	1U << 13,	1U << 14,	1U << 15,
-			1U << 16,	1U << 17,	1U << 18,	1U << 19,	1U << 20,	1U << 21,	1U << 22,	1U << 23,
-			1U << 24,	1U << 25,	1U << 26,	1U << 27,	1U << 28,	1U << 29,	1U << 30,	1U << 31,
-		};
-		return (idx >= 32) ? 0 : BitTbl[idx];
+		return (idx >= 32) ? 0 : (1U << idx);
 
 	} // end of TCBIT::Get
 
@@ -74,15 +90,7 @@ namespace TCBIT
 	*/
 	uint32_t	GetMask(size_t width)
 	{
-		uint32_t	rv = 0;
-
-		if (width > 32) {
-			width = 32;
-		}
-		for (size_t ii = 0; ii < width; ii++) {
-			rv |= Get(ii);
-		}
-		return rv;
+		return (width >= 32) ? 0xFFFFFFFFU : ((1U << width) - 1);
 
 	} // end of TCBIT::GetMask
 
@@ -105,6 +113,21 @@ namespace TCBIT
 
 	} // end of TCBIT::Shift
 
+	/*!
+		与えられた数値に含まれる On ビットの数を、組み込み命令を使わずに返します。
+		通常は Count を使用してください（ベンチマークで比較するために公開しています）。
+		@param[in] bitmap 入力とする数値
+		@return On ビットの数
+	*/
+	size_t	Count_Portable(uint32_t bitmap)
+	{
+		bitmap = bitmap - ((bitmap >> 1) & 0x55555555U);
+		bitmap = (bitmap & 0x33333333U) + ((bitmap >> 2) & 0x33333333U);
+		bitmap = (bitmap + (bitmap >> 4)) & 0x0F0F0F0FU;
+		return (bitmap * 0x01010101U) >> 24;
+
+	} // end of TCBIT::Count_Portable
+
 	/*!
 		与えられた数値に含まれる On ビットの数を返します。
 		@param[in] bitmap 入力とする数値
@@ -113,17 +136,181 @@ namespace TCBIT
 	*/
 	size_t	Count(uint32_t bitmap, size_t width = 32)
 	{
-		size_t	rv = 0;
-		if (width > 32) {
-			width = 32;
+		bitmap &= GetMask(width);
+#if TCBIT_INTRINSICS && defined(_MSC_VER) && TCBIT_POPCNT
+		return __popcnt(bitmap);
+#elif TCBIT_INTRINSICS && defined(__GNUC__) && defined(__POPCNT__)
+		return __builtin_popcount(bitmap);
+#else
+		return Count_Portable(bitmap);
+#endif
+
+	} // end of TCBIT::Count
+
+	/*!
+		与えられた数値で On である最下位ビットの番号を、組み込み命令を使わずに返します。
+		通常は FindLowest を使用してください（ベンチマークで比較するために公開しています）。
+		@param[in] bitmap 入力とする数値
+		@retval 最下位の On ビットの番号（0～31）
+		@retval 32（bitmap が 0 のとき）
+	*/
+	size_t	FindLowest_Portable(uint32_t bitmap)
+	{
+		static const uint8_t	DeBruijnTbl[32] = {
+			0,	1,	28,	2,	29,	14,	24,	3,	30,	22,	20,	15,	25,	17,	4,	8,
+			31,	27,	13,	23,	21,	19,	16,	7,	26,	12,	18,	6,	11,	5,	10,	9,
+		};
+		if (bitmap == 0) {
+			return 32;
 		}
-		for (size_t ii = 0; ii < width; ii++) {
-			rv += (bitmap & 0x00000001U) ? 1 : 0;
-			bitmap >>= 1;
+		return DeBruijnTbl[((bitmap & (0U - bitmap)) * 0x077CB531U) >> 27];
+
+	} // end of TCBIT::FindLowest_Portable
+
+	/*!
+		与えられた数値で On である最下位ビットの番号を返します。
+		On ビットを下位から順に処理するときは、bitmap &= bitmap - 1 と組み合わせて使用します。
+		@param[in] bitmap 入力とする数値
+		@retval 最下位の On ビットの番号（0～31）
+		@retval 32（bitmap が 0 のとき）
+	*/
+	size_t	FindLowest(uint32_t bitmap)
+	{
+#if TCBIT_INTRINSICS && defined(_MSC_VER)
+		unsigned long	idx;
+		return _BitScanForward(&idx, bitmap) ? idx : 32;
+#elif TCBIT_INTRINSICS && defined(__GNUC__)
+		return (bitmap == 0) ? 32 : __builtin_ctz(bitmap);
+#else
+		return FindLowest_Portable(bitmap);
+#endif
+
+	} // end of TCBIT::FindLowest
+
+	/*!
+		与えられた数値で On である最上位ビットの番号を、組み込み命令を使わずに返します。
+		通常は FindHighest を使用してください（ベンチマークで比較するために公開しています）。
+		@param[in] bitmap 入力とする数値
+		@retval 最上位の On ビットの番号（0～31）
+		@retval 32（bitmap が 0 のとき）
+	*/
+	size_t	FindHighest_Portable(uint32_t bitmap)
+	{
+		if (bitmap == 0) {
+			return 32;
 		}
-		return rv;
+		bitmap |= bitmap >> 1;
+		bitmap |= bitmap >> 2;
+		bitmap |= bitmap >> 4;
+		bitmap |= bitmap >> 8;
+		bitmap |= bitmap >> 16;
+		return Count_Portable(bitmap) - 1;
 
-	} // end of TCBIT::Count
+	} // end of TCBIT::FindHighest_Portable
+
+	/*!
+		与えられた数値で On である最上位ビットの番号を返します。
+		@param[in] bitmap 入力とする数値
+		@retval 最上位の On ビットの番号（0～31）
+		@retval 32（bitmap が 0 のとき）
+	*/
+	size_t	FindHighest(uint32_t bitmap)
+	{
+#if TCBIT_INTRINSICS && defined(_MSC_VER)
+		unsigned long	idx;
+		return _BitScanReverse(&idx, bitmap) ? idx : 32;
+#elif TCBIT_INTRINSICS && defined(__GNUC__)
+		return (bitmap == 0) ? 32 : 31 - __builtin_clz(bitmap);
+#else
+		return FindHighest_Portable(bitmap);
+#endif
+
+	} // end of TCBIT::FindHighest
+
+	/*!
+		フィールドの１段を表す整数型ごとに、ビット演算をまとめたクラスです。
+		TCFIELDT など、１段の整数型をテンプレート引数にとるクラスから使用します。
+		uint16_t・uint32_t は上記の 32bit 版を、uint64_t は 32bit 版を上下に分けて使用します。
+	*/
+	template <typename ROW>
+	class TRAITS
+	{
+	public:
+		static const size_t	BITS = sizeof(ROW) * 8;	//!< ビット幅
+
+		static ROW	Get(size_t idx)
+		{
+			return static_cast<ROW>(TCBIT::Get(idx));
+
+		} // end of TCBIT::TRAITS::Get
+
+		static ROW	GetMask(size_t width)
+		{
+			return static_cast<ROW>(TCBIT::GetMask(width));
+
+		} // end of TCBIT::TRAITS::GetMask
+
+		static size_t	Count(ROW bitmap)
+		{
+			return TCBIT::Count(bitmap);
+
+		} // end of TCBIT::TRAITS::Count
+
+		static size_t	FindLowest(ROW bitmap)
+		{
+			return (bitmap == 0) ? BITS : TCBIT::FindLowest(bitmap);
+
+		} // end of TCBIT::TRAITS::FindLowest
+
+		static size_t	FindHighest(ROW bitmap)
+		{
+			return (bitmap == 0) ? BITS : TCBIT::FindHighest(bitmap);
+
+		} // end of TCBIT::TRAITS::FindHighest
+	};
+
+	template <>
+	class TRAITS<uint64_t>
+	{
+	public:
+		static const size_t	BITS = 64;	//!< ビット幅
+
+		static uint64_t	Get(size_t idx)
+		{
+			return (idx >= BITS) ? 0 : (static_cast<uint64_t>(1) << idx);
+
+		} // end of TCBIT::TRAITS<uint64_t>::Get
+
+		static uint64_t	GetMask(size_t width)
+		{
+			return (width >= BITS) ? ~static_cast<uint64_t>(0) : ((static_cast<uint64_t>(1) << width) - 1);
+
+		} // end of TCBIT::TRAITS<uint64_t>::GetMask
+
+		static size_t	Count(uint64_t bitmap)
+		{
+			return TCBIT::Count(static_cast<uint32_t>(bitmap)) + TCBIT::Count(static_cast<uint32_t>(bitmap >> 32));
+
+		} // end of TCBIT::TRAITS<uint64_t>::Count
+
+		static size_t	FindLowest(uint64_t bitmap)
+		{
+			if (static_cast<uint32_t>(bitmap)) {
+				return TCBIT::FindLowest(static_cast<uint32_t>(bitmap));
+			}
+			return (bitmap == 0) ? BITS : 32 + TCBIT::FindLowest(static_cast<uint32_t>(bitmap >> 32));
+
+		} // end of TCBIT::TRAITS<uint64_t>::FindLowest
+
+		static size_t	FindHighest(uint64_t bitmap)
+		{
+			if (static_cast<uint32_t>(bitmap >> 32)) {
+				return 32 + TCBIT::FindHighest(static_cast<uint32_t>(bitmap >> 32));
+			}
+			return (bitmap == 0) ? BITS : TCBIT::FindHighest(static_cast<uint32_t>(bitmap));
+
+		} // end of TCBIT::TRAITS<uint64_t>::FindHighest
+	};
 };
 
 
@@ -47,6 +47,8 @@ enum _TCEVENT
 	TCEVENT_nMOVE_R		= (1U << 9),	//!< ピースを右に移動させたかったが壁が邪魔で移動できなかった
 	TCEVENT_nROT_L		= (1U << 10),	//!< ピースを左回転させたかったが壁が邪魔で移動できなかった
 	TCEVENT_nROT_R		= (1U << 11),	//!< ピースを右回転させたかったが壁が邪魔で移動できなかった
+	TCEVENT_nMOVE		= (TCEVENT_nMOVE_L | TCEVENT_nMOVE_R),
+	TCEVENT_nROT		= (TCEVENT_nROT_L | TCEVENT_nROT_R),
 
 	// シーケンスイベント
 	TCEVENT_PREP		= (1U << 12),	//!< 次のフレームにピースが落下開始する瞬間
@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCEVENTQUEUE_H
+#define TCEVENTQUEUE_H
+//! @file
+
+#include <utility>
+#include <vector>
+#include "tctype.h"
+#include "tcevent.h"
+
+//----------------------------------------------------------------------------
+/*!
+	プレイフィールドで発生したイベントを、発生順にためておくためのキューです。
+	容量を固定したリングバッファなので、生成後はイベントを出し入れしてもメモリを確保しません。
+	容量を超えてイベントが入れられたときは、古いものから捨てます（画面出力用なので、取りこぼしは許容する）。
+*/
+class TCEVENTQUEUE
+{
+	//
+	// assign
+	//
+public:
+	typedef std::pair<size_t, TCEVENT>	EVENTX;	//!< プレイフィールドの番号（0～）と、発生したイベントの組
+
+	//
+	// variable
+	//
+private:
+	std::vector<EVENTX>		m_Buffer;	//!< リングバッファ
+	size_t					m_Head;		//!< 最も古いイベントの位置
+	size_t					m_Count;	//!< ためているイベントの数
+	size_t					m_Dropped;	//!< 容量を超えたために捨てたイベントの数（Clear まで累計）
+
+	//
+	// method
+	//
+public:
+	/*!
+		標準のコンストラクタです。
+		@param[in] Capacity ためておけるイベントの数（1～）
+	*/
+	TCEVENTQUEUE(size_t Capacity)
+		: m_Buffer(max(Capacity, 1)),
+		m_Head(0),
+		m_Count(0),
+		m_Dropped(0)
+	{
+	} // end of TCEVENTQUEUE::ctor
+
+	/*!
+		ためているイベントをすべて捨てます。
+	*/
+	void	Clear()
+	{
+		m_Head = 0;
+		m_Count = 0;
+		m_Dropped = 0;
+
+	} // end of TCEVENTQUEUE::Clear
+
+	/*!
+		イベントを末尾に入れます。
+		容量いっぱいのときは、最も古いイベントを捨てます。
+		@param[in] Index イベントが発生したプレイフィールドの番号（0～）
+		@param[in] Event 発生したイベント
+	*/
+	void	Push(size_t Index, TCEVENT Event)
+	{
+		if (m_Count == m_Buffer.size()) {
+			Pop();
+			m_Dropped++;
+		}
+		m_Buffer[(m_Head + m_Count) % m_Buffer.size()] = EVENTX(Index, Event);
+		m_Count++;
+
+	} // end of TCEVENTQUEUE::Push
+
+	/*!
+		最も古いイベントを参照します。
+		@return イベント
+	*/
+	const EVENTX	&Front() const
+	{
+		TCASSERT(m_Count > 0, "queue empty.");
+		return m_Buffer[m_Head];
+
+	} // end of TCEVENTQUEUE::Front
+
+	/*!
+		最も古いイベントを捨てます。
+	*/
+	void	Pop()
+	{
+		TCASSERT(m_Count > 0, "queue empty.");
+		m_Head = (m_Head + 1) % m_Buffer.size();
+		m_Count--;
+
+	} // end of TCEVENTQUEUE::Pop
+
+	/*!
+		古いほうから指定された数までのイベントを取り出します。
+		１回の描画で処理するイベントの数を抑えるために使います。
+		@param[out] pEvents 取り出したイベントの格納先（MaxCount 個分）
+		@param[in] MaxCount 取り出すイベントの最大数
+		@return 取り出したイベントの数
+	*/
+	size_t	Drain(EVENTX *pEvents, size_t MaxCount)
+	{
+		size_t	Count = min(m_Count, MaxCount);
+		for (size_t ii = 0; ii < Count; ii++) {
+			pEvents[ii] = Front();
+			Pop();
+		}
+		return Count;
+
+	} // end of TCEVENTQUEUE::Drain
+
+	/*!
+		イベントがたまっていないかどうかを返します。
+		@retval true たまっていない
+		@retval false たまっている
+	*/
+	bool	IsEmpty() const
+	{
+		return m_Count == 0;
+
+	} // end of TCEVENTQUEUE::IsEmpty
+
+	/*!
+		ためているイベントの数を返します。
+		@return イベントの数
+	*/
+	size_t	GetCount() const
+	{
+		return m_Count;
+
+	} // end of TCEVENTQUEUE::GetCount
+
+	/*!
+		容量を超えたために捨てたイベントの数を返します。
+		@return イベントの数
+	*/
+	size_t	GetDropped() const
+	{
+		return m_Dropped;
+
+	} // end of TCEVENTQUEUE::GetDropped
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCEVENTQUEUE_H
@@ -28,27 +28,133 @@
 #define TCFIELD_H
 //! @file
 
-#include <vector>
+#include <cstring>
 #include "tctype.h"
 #include "tcbit.h"
+#include "tchash.h"
 #include "tcpiece.h"
 #include "tcpos.h"
 #include "tcsize.h"
 
 //----------------------------------------------------------------------------
+/*!
+	1 にすると、TCFIELDT::IsSetPiece および SetPiece が、
+	ピースが覆う４段分をまとめて 64bit 演算で処理するカーネルを使用します。
+	0 にすると、１段ずつ処理するループを使用します。
+*/
+#ifndef TCFIELD_PACKED_KERNEL
+#define TCFIELD_PACKED_KERNEL	1
+#endif
+
+/*!
+	1 にすると、TCFIELDT が行ごとのビットマップとは別に、列ごとのビットマップ（転置したフィールド）を保持します。
+	GetColumn・GetHoles が列を走査せずに済むようになる代わりに、SetPiece・RemoveLines で更新する分だけ遅くなります。
+	0 にすると、GetColumn・GetHoles は呼ばれるたびに各段から列を組み立てます。
+*/
+#ifndef TCFIELD_COLUMNS
+#define TCFIELD_COLUMNS	1
+#endif
+
 /*!
 	フィールドの状態を保持しているクラスです。
 	どの箇所が埋まっているかを確認したり、ピースを配置してみたりすることができます。
 	コピー・代入に対応しています。
+	フィールドの１段を表す整数型 ROW_T によって、扱えるフィールドの幅が決まります（枠の２列を含めて ROW_T に収まる幅）。
+	通常は ROW_T が uint32_t である TCFIELD を使用します（TCPLAYER に渡されるのも TCFIELD です）。
+	幅の狭いフィールドを探索などで大量に扱うときは TCFIELD16 を、幅が 30 を超えるフィールドには TCFIELD64 を使用できます。
+	フィールドのビットマップは最大の高さ分を固定長でインスタンス内に保持しているため、
+	コピー・代入でヒープの確保・解放は発生しません。
+	列ごとの高さと段ごとのスポット数、ハッシュ値は、ピースの配置とラインの消去に合わせて差分で更新しているため、
+	GetHeight・GetSpots・CountSpots・GetHash は保持している値を返すだけです。
 */
-class TCFIELD
+template <typename ROW_T>
+class TCFIELDT
 {
 	//
 	// assign
 	//
-private:
+public:
+	typedef ROW_T					ROW;	//!< フィールドの１段を表す整数型
+	typedef TCBIT::TRAITS<ROW>		BIT;	//!< ROW に対するビット演算
+
 	static const int8_t	FIELD_WIDTH_MIN = TCPIECE::PIECE_WIDTH;
-	static const int8_t	FIELD_WIDTH_MAX = 30;	// because of impl
+	static const int8_t	FIELD_WIDTH_MAX = BIT::BITS - 2;	//!< 枠を含めて１段が ROW に収まる幅
+	static const int8_t	FIELD_HEIGHT_MIN = TCPIECE::PIECE_WIDTH;
+	static const int8_t	FIELD_HEIGHT_MAX = 30;
+	static const size_t	DROP_COUNT = FIELD_WIDTH_MAX + 1 - TCPIECE::MASK_POS_X_MIN;	//!< GetDropY が着地位置を返す配列の要素数
+	static const int8_t	DROP_NONE = 127;	//!< GetDropY で、その X 位置には落下前の位置にピースを配置できないことを表す値
+
+private:
+	static const int8_t	ROW_GUARD = TCPIECE::PIECE_WIDTH - 1;	//!< フィールド上下の枠の外側に置く空の番兵段の数（当たり判定を段ごとの範囲チェックなしで行うため）
+	static const size_t	PACKED_COUNT = sizeof(ROW) * TCPIECE::PIECE_WIDTH / sizeof(uint64_t);	//!< ピースが覆う４段分を詰めた 64bit 整数の数
+
+public:
+	/*!
+		MakeMove で変更したフィールドを、UnmakeMove で元に戻すための記録です。
+		コピー・代入に対応しています。
+	*/
+	class UNDO
+	{
+		friend class TCFIELDT;
+
+		//
+		// variable
+		//
+	private:
+		int8_t			m_PosY;								//!< ピースを配置した縦位置
+		ROW				m_Rows[TCPIECE::PIECE_WIDTH];		//!< ピースを配置する前の４段分のビットマップ
+		uint32_t		m_LinesMask;						//!< 取り除いたラインの位置（bitN が Y=N の段に対応）
+		int8_t			m_Height[FIELD_WIDTH_MAX + 2];		//!< ピースを配置する前の列ごとの高さ
+		int8_t			m_Spots[FIELD_HEIGHT_MAX + 2];		//!< ピースを配置する前の段ごとのスポット数
+		size_t			m_SpotCount;						//!< ピースを配置する前のスポット数
+		uint64_t		m_Hash;								//!< ピースを配置する前のハッシュ値
+#if TCFIELD_COLUMNS
+		uint32_t		m_Column[FIELD_WIDTH_MAX + 2];		//!< ピースを配置する前の列ごとのビットマップ
+#endif
+
+		//
+		// method
+		//
+	public:
+		/*!
+			デフォルトのコンストラクタです。
+			何も変更していない記録に初期化されます。
+		*/
+		UNDO()
+			: m_PosY(0),
+			m_LinesMask(0),
+			m_SpotCount(0),
+			m_Hash(0)
+		{
+			memset(m_Rows, 0, sizeof(m_Rows));
+			memset(m_Height, 0, sizeof(m_Height));
+			memset(m_Spots, 0, sizeof(m_Spots));
+#if TCFIELD_COLUMNS
+			memset(m_Column, 0, sizeof(m_Column));
+#endif
+
+		} // end of TCFIELD::UNDO::ctor
+
+		/*!
+			取り除いたラインの数を返します。
+			@return 取り除いたライン数
+		*/
+		int8_t	GetLines() const
+		{
+			return static_cast<int8_t>(TCBIT::Count(m_LinesMask));
+
+		} // end of TCFIELD::UNDO::GetLines
+
+		/*!
+			取り除いたラインの位置を返します。
+			@return 取り除いたラインのビットマスク（bitN が Y=N の段に対応）
+		*/
+		uint32_t	GetLinesMask() const
+		{
+			return m_LinesMask;
+
+		} // end of TCFIELD::UNDO::GetLinesMask
+	};
 
 	//
 	// variable
@@ -56,8 +162,15 @@ private:
 private:
 	size_t					m_Gravity;		//!< 重力係数（1=0.1G、10=1G、200=20G）
 	TCSIZE					m_FieldSize;	//!< フィールドのサイズ（枠を含む）
-	std::vector<uint32_t>	m_Field;		//!< フィールドのビットマップ（枠を含む）
-	uint32_t				m_LineFilled;	//!< １ラインが埋まった状態（枠を含まない）
+	ROW						m_Field[ROW_GUARD + FIELD_HEIGHT_MAX + 2 + ROW_GUARD];	//!< フィールドのビットマップ（枠を含む。上下に番兵段を含む）
+	ROW						m_LineFilled;	//!< １ラインが埋まった状態（枠を含まない）
+	int8_t					m_Height[FIELD_WIDTH_MAX + 2];	//!< 列ごとの高さ（最も上にある埋まっているマスの Y 値。空の列は 0）
+	int8_t					m_Spots[FIELD_HEIGHT_MAX + 2];	//!< 段ごとのスポット数
+	size_t					m_SpotCount;	//!< スポット数（m_Spots の合計）
+	uint64_t				m_Hash;			//!< フィールドのハッシュ値（枠の内側の埋まっているマスの TCHASH::GetCellKey の XOR）
+#if TCFIELD_COLUMNS
+	uint32_t				m_Column[FIELD_WIDTH_MAX + 2];	//!< 列ごとのビットマップ（bitN が Y=N の段に対応。地面の bit0 は常に 1、天井は含まない）
+#endif
 
 	//
 	// method
@@ -66,15 +179,16 @@ public:
 	/*!
 		標準のコンストラクタです。
 		標準的なフィールドサイズは Width=10、Height=18 です。
-		@param[in] Width 枠を含まないフィールドの幅
-		@param[in] Height 枠を含まないフィールドの高さ
+		@param[in] Width 枠を含まないフィールドの幅（4～FIELD_WIDTH_MAX）
+		@param[in] Height 枠を含まないフィールドの高さ（4～30）
 		@param[in] Gravity フィールドの落下重力（1=0.1G）
 	*/
-	TCFIELD(int8_t Width, int8_t Height, size_t Gravity = 1)
+	TCFIELDT(int8_t Width, int8_t Height, size_t Gravity = 1)
 		: m_Gravity(Gravity),
 		m_FieldSize(0, 0),
-		m_Field(),
-		m_LineFilled(0)
+		m_LineFilled(0),
+		m_SpotCount(0),
+		m_Hash(0)
 	{
 		if (Width < FIELD_WIDTH_MIN) {
 			Width = FIELD_WIDTH_MIN;
@@ -82,20 +196,25 @@ public:
 		if (Width >= FIELD_WIDTH_MAX) {
 			Width = FIELD_WIDTH_MAX;
 		}
-		if (Height < TCPIECE::PIECE_WIDTH) {
-			Height = TCPIECE::PIECE_WIDTH;
+		if (Height < FIELD_HEIGHT_MIN) {
+			Height = FIELD_HEIGHT_MIN;
+		}
+		if (Height >= FIELD_HEIGHT_MAX) {
+			Height = FIELD_HEIGHT_MAX;
 		}
 		m_FieldSize = TCSIZE(Width + 2, Height + 2);	// +2 is for frame
 
-		m_LineFilled = TCBIT::GetMask(Width) << 1;
-		uint32_t	LineFrame = ((m_LineFilled << 1) | (m_LineFilled >> 1)) & ~m_LineFilled;
+		m_LineFilled = static_cast<ROW>(BIT::GetMask(Width) << 1);
+		ROW		LineFrame = static_cast<ROW>(((m_LineFilled << 1) | (m_LineFilled >> 1)) & ~m_LineFilled);
 
-		m_Field.resize(m_FieldSize.GetY());
+		memset(m_Field, 0, sizeof(m_Field));
 		for (int8_t yy = 0; yy < m_FieldSize.GetY(); yy++) {
-			m_Field[yy] = LineFrame;
+			m_Field[ROW_GUARD + yy] = LineFrame;
 		}
-		m_Field[0                     ] |= m_LineFilled;
-		m_Field[m_FieldSize.GetY() - 1] |= m_LineFilled;
+		m_Field[ROW_GUARD + 0                     ] |= m_LineFilled;
+		m_Field[ROW_GUARD + m_FieldSize.GetY() - 1] |= m_LineFilled;
+		UpdateSpots_All();
+		UpdateHash_All();
 
 	} // end of TCFIELD::ctor
 
@@ -104,12 +223,20 @@ public:
 		各メンバはコピー元のインスタンスに初期化されます。
 		@param[in] Rhs コピー元のインスタンス
 	*/
-	TCFIELD(const TCFIELD &Rhs)
+	TCFIELDT(const TCFIELDT &Rhs)
 		: m_Gravity(Rhs.m_Gravity),
 		m_FieldSize(Rhs.m_FieldSize),
-		m_Field(Rhs.m_Field),
-		m_LineFilled(Rhs.m_LineFilled)
+		m_LineFilled(Rhs.m_LineFilled),
+		m_SpotCount(Rhs.m_SpotCount),
+		m_Hash(Rhs.m_Hash)
 	{
+		memcpy(m_Field, Rhs.m_Field, sizeof(m_Field));
+		memcpy(m_Height, Rhs.m_Height, sizeof(m_Height));
+		memcpy(m_Spots, Rhs.m_Spots, sizeof(m_Spots));
+#if TCFIELD_COLUMNS
+		memcpy(m_Column, Rhs.m_Column, sizeof(m_Column));
+#endif
+
 	} // end of TCFIELD::ctor
 
 	/*!
@@ -118,24 +245,63 @@ public:
 		@param[in] Rhs コピー元のインスタンス
 		@return このインスタンス
 	*/
-	TCFIELD	&operator=(const TCFIELD &Rhs)
+	TCFIELDT	&operator=(const TCFIELDT &Rhs)
 	{
 		m_Gravity    = Rhs.m_Gravity;
 		m_FieldSize  = Rhs.m_FieldSize;
-		m_Field      = Rhs.m_Field;
 		m_LineFilled = Rhs.m_LineFilled;
+		m_SpotCount  = Rhs.m_SpotCount;
+		m_Hash       = Rhs.m_Hash;
+		memcpy(m_Field, Rhs.m_Field, sizeof(m_Field));
+		memcpy(m_Height, Rhs.m_Height, sizeof(m_Height));
+		memcpy(m_Spots, Rhs.m_Spots, sizeof(m_Spots));
+#if TCFIELD_COLUMNS
+		memcpy(m_Column, Rhs.m_Column, sizeof(m_Column));
+#endif
 		return *this;
 
 	} // end of TCFIELD::operator=
 
+	/*!
+		１段の整数型が異なるフィールドから変換するコンストラクタです。
+		探索の前に、幅に合った整数型のフィールドへ一度だけ変換するときなどに使用します。
+		変換元のフィールドの幅は、このクラスの FIELD_WIDTH_MAX 以下でなければなりません。
+		@param[in] Rhs 変換元のインスタンス
+	*/
+	template <typename ROW2>
+	explicit TCFIELDT(const TCFIELDT<ROW2> &Rhs)
+		: m_Gravity(Rhs.GetGravity()),
+		m_FieldSize(0, 0),
+		m_LineFilled(0),
+		m_SpotCount(0),
+		m_Hash(0)
+	{
+		*this = TCFIELDT(Rhs.GetSize().GetX() - 2, Rhs.GetSize().GetY() - 2, Rhs.GetGravity());	// -2 is for frame
+		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
+			m_Field[ROW_GUARD + yy] = static_cast<ROW>(Rhs.GetBitmap(yy));
+			m_Spots[yy] = Rhs.GetSpots(yy);
+		}
+		for (int8_t xx = 1; xx < m_FieldSize.GetX() - 1; xx++) {
+			m_Height[xx] = Rhs.GetHeight(xx);
+#if TCFIELD_COLUMNS
+			m_Column[xx] = Rhs.GetColumn(xx);
+#endif
+		}
+		m_SpotCount = Rhs.CountSpots();
+		m_Hash = Rhs.GetHash();	// キーは１段の整数型によらないので、そのまま使える
+
+	} // end of TCFIELD::ctor
+
 	/*!
 		ゲームを開始するため、フィールドの状態を初期化します。
 	*/
 	void	StartGame()
 	{
 		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
-			m_Field[yy] &= ~m_LineFilled;
+			m_Field[ROW_GUARD + yy] &= static_cast<ROW>(~m_LineFilled);
 		}
+		UpdateSpots_All();
+		UpdateHash_All();
 
 	} // end of TCFIELD::StartGame
 
@@ -182,9 +348,9 @@ public:
 		@param[in] PosY 高さ（Y 値、0～フィールド高さ+1）
 		@return 指定された段のビットマップ
 	*/
-	uint32_t	GetBitmap(int8_t PosY) const
+	ROW		GetBitmap(int8_t PosY) const
 	{
-		return (PosY < 0) || (static_cast<uint8_t>(PosY) >= m_Field.size()) ? 0 : m_Field[PosY];
+		return (PosY < 0) || (PosY >= m_FieldSize.GetY()) ? 0 : m_Field[ROW_GUARD + PosY];
 
 	} // end of GetBitmap
 
@@ -203,7 +369,7 @@ public:
 	*/
 	uint32_t	GetBitmap(int8_t PosX, int8_t PosY) const
 	{
-		return (PosY < 0) || (static_cast<uint8_t>(PosY) >= m_Field.size()) ? 0 : (m_Field[PosY] & TCBIT::Get(PosX) ? 1 : 0);
+		return (PosY < 0) || (PosY >= m_FieldSize.GetY()) ? 0 : (m_Field[ROW_GUARD + PosY] & BIT::Get(PosX) ? 1 : 0);
 
 	} // end of GetBitmap
 
@@ -212,12 +378,79 @@ public:
 		ラインが１段埋まった状態かどうかをチェックする際などに利用します。
 		@return １段埋まった状態のビットマップ
 	*/
-	uint32_t	GetLineFilled() const
+	ROW		GetLineFilled() const
 	{
 		return m_LineFilled;
 
 	} // end of GetLineFilled
 
+	/*!
+		フィールドの１列分の高さを取得します。
+		高さとは、その列で最も上にある埋まっているマスの Y 値です。
+		@param[in] PosX 横位置（X 値、0～フィールド幅+1）
+		@return 指定された列の高さ（列が空のとき、および枠の列を指定したときは 0）
+	*/
+	int8_t	GetHeight(int8_t PosX) const
+	{
+		return (PosX < 1) || (PosX >= m_FieldSize.GetX() - 1) ? 0 : m_Height[PosX];
+
+	} // end of TCFIELD::GetHeight
+
+	/*!
+		フィールドの１段分のスポットの数を取得します。
+		スポットについては CountSpots を参照してください。
+		@param[in] PosY 縦位置（Y 値、0～フィールド高さ+1）
+		@return 指定された段のスポット数（枠の段を指定したときは 0）
+	*/
+	int8_t	GetSpots(int8_t PosY) const
+	{
+		return (PosY < 0) || (PosY >= m_FieldSize.GetY()) ? 0 : m_Spots[PosY];
+
+	} // end of TCFIELD::GetSpots
+
+	/*!
+		フィールドの１列分のビットマップ（形状）を取得します。
+		得られたビットマップの bitN が、Y=N の段のマスに対応します。
+		bit0 は地面で常に 1 です。天井は含みません。
+		このため、TCBIT::FindHighest で列の高さが、TCBIT::Count で列の埋まっているマスの数（＋１）が得られます。
+		@param[in] PosX 横位置（X 値、1～フィールド幅）
+		@return 指定された列のビットマップ（枠の列を指定したときは 0）
+	*/
+	uint32_t	GetColumn(int8_t PosX) const
+	{
+		if ((PosX < 1) || (PosX >= m_FieldSize.GetX() - 1)) {
+			return 0;
+		}
+#if TCFIELD_COLUMNS
+		return m_Column[PosX];
+#else
+		uint32_t	Value = TCBIT::Get(0);
+		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
+			if (m_Field[ROW_GUARD + yy] & BIT::Get(PosX)) {
+				Value |= TCBIT::Get(yy);
+			}
+		}
+		return Value;
+#endif
+
+	} // end of TCFIELD::GetColumn
+
+	/*!
+		フィールドの１列分のスポットの数を取得します。
+		スポットについては CountSpots を参照してください。
+		@param[in] PosX 横位置（X 値、0～フィールド幅+1）
+		@return 指定された列のスポット数（枠の列を指定したときは 0）
+	*/
+	int8_t	GetHoles(int8_t PosX) const
+	{
+		uint32_t	Column = GetColumn(PosX);
+		if (Column == 0) {
+			return 0;
+		}
+		return static_cast<int8_t>(TCBIT::FindHighest(Column) + 1 - TCBIT::Count(Column));
+
+	} // end of TCFIELD::GetHoles
+
 	/*!
 		フィールド上に指定されたピースを配置できるかどうかを返します。
 		@param[in] Piece 配置するピース
@@ -239,25 +472,142 @@ public:
 	*/
 	bool	IsSetPiece(const TCPIECE &Piece, const TCPOS &Pos) const
 	{
-		std::vector<uint32_t>	bitmap = TCPIECE::GetBitmap(Piece);
+#if TCFIELD_PACKED_KERNEL
+		return IsSetPiece_Packed(Piece, Pos);
+#else
+		return IsSetPiece_Loop(Piece, Pos);
+#endif
+
+	} // end of TCFIELD::IsSetPiece
+
+	/*!
+		フィールド上に指定されたピースを配置できるかどうかを、１段ずつ判定します。
+		通常は IsSetPiece を使用してください（ベンチマークで比較するために公開しています）。
+		@param[in] Piece 配置するピース（ただし位置は参照されない。代わりに Pos が参照される）
+		@param[in] Pos 配置する位置
+		@retval true 配置できる
+		@retval false 配置できない
+	*/
+	bool	IsSetPiece_Loop(const TCPIECE &Piece, const TCPOS &Pos) const
+	{
+		const ROW	*mask = TCPIECE::GetRowMask<ROW>(Piece.m_Fig, Piece.m_Rot, Pos.GetX());
 		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
 			if (
 				(0 <= Pos.GetY() + yy) && (Pos.GetY() + yy < m_FieldSize.GetY()) &&
-				(TCBIT::Shift(bitmap[yy], Pos.GetX()) & m_Field[Pos.GetY() + yy])
+				(mask[yy] & m_Field[ROW_GUARD + Pos.GetY() + yy])
 			) {
 				return false;
 			}
 		}
 		return true;
 
-	} // end of TCFIELD::IsSetPiece
+	} // end of TCFIELD::IsSetPiece_Loop
+
+	/*!
+		フィールド上に指定されたピースを配置できるかどうかを、４段まとめて判定します。
+		ピースが覆う４段分のフィールドを 64bit 整数に詰めて読み出し（ROW が uint32_t なら２つ）、
+		同じく詰めたピースのビットマップと AND をとるだけで判定します。
+		番兵段の外側にはみ出す位置の場合は、IsSetPiece_Loop で判定します。
+		通常は IsSetPiece を使用してください（ベンチマークで比較するために公開しています）。
+		@param[in] Piece 配置するピース（ただし位置は参照されない。代わりに Pos が参照される）
+		@param[in] Pos 配置する位置
+		@retval true 配置できる
+		@retval false 配置できない
+	*/
+	bool	IsSetPiece_Packed(const TCPIECE &Piece, const TCPOS &Pos) const
+	{
+		if (
+			(Pos.GetY() < -ROW_GUARD) ||
+			(Pos.GetY() > m_FieldSize.GetY() - 1)
+		) {
+			return IsSetPiece_Loop(Piece, Pos);
+		}
+
+		const uint64_t	*mask = TCPIECE::GetPackedRowMask<ROW>(Piece.m_Fig, Piece.m_Rot, Pos.GetX());
+		uint64_t		rows[PACKED_COUNT];
+		uint64_t		hit = 0;
+		memcpy(rows, &m_Field[ROW_GUARD + Pos.GetY()], sizeof(rows));
+		for (size_t ii = 0; ii < PACKED_COUNT; ii++) {
+			hit |= rows[ii] & mask[ii];
+		}
+		return hit == 0;
+
+	} // end of TCFIELD::IsSetPiece_Packed
+
+	/*!
+		指定されたピースを、すべての X 位置からそれぞれ真下に落下させたときの着地位置（Y 値）をまとめて求めます。
+		ATU::LimitD をすべての X 位置について呼び出すのと同じ結果を、段の走査１回（O(フィールド高さ)）で求めます。
+		X 位置ごとに当たり判定をするのではなく、段のビットマップをピースの各マスの分だけシフトして OR をとり、
+		「その段に置くとぶつかる X 位置」を１段につき１回の演算でまとめて求めます。
+		ピースの X 位置は参照されません。Y 位置は落下前の位置として参照されます。
+		対象となるのは、ピースの最も右の列がフィールドの内側（X=1～フィールド幅）にある X 位置です。
+		@param[in] Piece 落下させるピース
+		@param[out] DropY 各 X 位置の着地位置（DropY[X 値 - TCPIECE::MASK_POS_X_MIN]。落下前の位置に配置できない X 位置は DROP_NONE）
+		@return 落下前の位置に配置できる X 位置の数
+	*/
+	size_t	GetDropY(const TCPIECE &Piece, int8_t DropY[DROP_COUNT]) const
+	{
+		for (size_t ii = 0; ii < DROP_COUNT; ii++) {
+			DropY[ii] = DROP_NONE;
+		}
+
+		// ピースの最も右の列を基準にした、各マスの相対位置
+		int8_t	CellX[TCPIECE::PIECE_WIDTH];
+		int8_t	CellY[TCPIECE::PIECE_WIDTH];
+		int8_t	OfsX = TCPIECE::GetCells(Piece.m_Fig, Piece.m_Rot, CellX, CellY);
+		if (OfsX < 0) {
+			return 0;
+		}
+
+		// Active の bitN は、基準の列が X=N の位置でまだ落下中であることを表す
+		int8_t	PosY = Piece.m_Pos.GetY();
+		ROW		Active = static_cast<ROW>(m_LineFilled & ~GetHitMap(PosY, CellX, CellY));
+		size_t	Value = BIT::Count(Active);
+
+		// 天井より上では何ともぶつからないので、天井の段から走査する（床にぶつかるまでに番兵段の外には出ない）
+		int8_t	StartY = (PosY - 1 < m_FieldSize.GetY() - 1) ? (PosY - 1) : (m_FieldSize.GetY() - 1);
+		for (int8_t yy = StartY; Active && (yy >= -ROW_GUARD); yy--) {
+			ROW		Stop = static_cast<ROW>(Active & GetHitMap_Guarded(yy, CellX, CellY));
+			Active &= static_cast<ROW>(~Stop);
+			for (; Stop; Stop &= Stop - 1) {
+				DropY[BIT::FindLowest(Stop) - OfsX - TCPIECE::MASK_POS_X_MIN] = yy + 1;
+			}
+		}
+		return Value;
+
+	} // end of TCFIELD::GetDropY
+
+	/*!
+		ピースを Y=PosY に置いたときに、フィールドとぶつかる X 位置をまとめて求めます。
+		すべての X 位置について IsSetPiece を呼び出すのと同じ結果を、ピースのマスの数だけのシフトと OR で求めます。
+		X 位置は、ピースの最も右の列の位置で表します（ピースの X 位置に TCPIECE::GetCells の戻り値を足した値）。
+		@param[in] PosY 縦位置（Y 値）
+		@param[in] CellX ピースの各マス（４つ）の、ピースの最も右の列からの横の距離（TCPIECE::GetCells で求める）
+		@param[in] CellY ピースの各マス（４つ）の縦の距離（TCPIECE::GetCells で求める）
+		@return ぶつかる位置のビットマップ（bitN が、ピースの最も右の列を X=N に置いた場合）
+	*/
+	ROW		GetHitMap(int8_t PosY, const int8_t CellX[TCPIECE::PIECE_WIDTH], const int8_t CellY[TCPIECE::PIECE_WIDTH]) const
+	{
+		if (
+			(PosY < -ROW_GUARD) ||
+			(PosY > m_FieldSize.GetY() - 1)
+		) {
+			ROW		Value = 0;
+			for (int8_t ii = 0; ii < TCPIECE::PIECE_WIDTH; ii++) {
+				Value |= static_cast<ROW>(GetBitmap(PosY + CellY[ii]) >> CellX[ii]);
+			}
+			return Value;
+		}
+		return GetHitMap_Guarded(PosY, CellX, CellY);
+
+	} // end of TCFIELD::GetHitMap
 
 	/*!
 		フィールド上に指定されたピースを配置します。
 		@param[in] Piece 配置するピース
 		@return フィールド
 	*/
-	TCFIELD	&SetPiece(const TCPIECE &Piece)
+	TCFIELDT	&SetPiece(const TCPIECE &Piece)
 	{
 		SetPiece(Piece, Piece.m_Pos);
 		return *this;
@@ -270,36 +620,154 @@ public:
 		@param[in] Pos 配置する位置
 		@return フィールド
 	*/
-	TCFIELD	&SetPiece(const TCPIECE &Piece, const TCPOS &Pos)
+	TCFIELDT	&SetPiece(const TCPIECE &Piece, const TCPOS &Pos)
 	{
-		std::vector<uint32_t>	bitmap = TCPIECE::GetBitmap(Piece);
+		ROW		Rows[TCPIECE::PIECE_WIDTH];
+		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
+			Rows[yy] = GetBitmap(Pos.GetY() + yy);
+		}
+
+#if TCFIELD_PACKED_KERNEL
+		if (
+			(Pos.GetY() >= 0) &&
+			(Pos.GetY() + TCPIECE::PIECE_WIDTH <= m_FieldSize.GetY())
+		) {
+			// 枠（地面・天井）の段はすでに埋まっているので、まとめて OR しても変化しない
+			const uint64_t	*mask = TCPIECE::GetPackedRowMask<ROW>(Piece.m_Fig, Piece.m_Rot, Pos.GetX());
+			uint64_t		rows[PACKED_COUNT];
+			memcpy(rows, &m_Field[ROW_GUARD + Pos.GetY()], sizeof(rows));
+			for (size_t ii = 0; ii < PACKED_COUNT; ii++) {
+				rows[ii] |= mask[ii];
+			}
+			memcpy(&m_Field[ROW_GUARD + Pos.GetY()], rows, sizeof(rows));
+		} else
+#endif
+		{
+			const ROW	*mask = TCPIECE::GetRowMask<ROW>(Piece.m_Fig, Piece.m_Rot, Pos.GetX());
+			for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
+				if ((1 <= Pos.GetY() + yy) && (Pos.GetY() + yy < m_FieldSize.GetY() - 1)) {
+					m_Field[ROW_GUARD + Pos.GetY() + yy] |= mask[yy];
+				}
+			}
+		}
+
+		// 新たに埋まったマスについて、下の段から順に高さとスポット数、ハッシュ値を更新する
 		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
 			if ((1 <= Pos.GetY() + yy) && (Pos.GetY() + yy < m_FieldSize.GetY() - 1)) {
-				m_Field[Pos.GetY() + yy] |= TCBIT::Shift(bitmap[yy], Pos.GetX());
+				ROW		Cells = static_cast<ROW>(m_Field[ROW_GUARD + Pos.GetY() + yy] & ~Rows[yy] & m_LineFilled);
+				if (Cells) {
+					UpdateSpots_Set(Pos.GetY() + yy, Cells);
+					m_Hash ^= TCHASH::GetRowKey(Pos.GetY() + yy, Cells);
+				}
 			}
 		}
 		return *this;
 
 	} // end of TCFIELD::SetPiece
 
-#if 0
-	void	UnsetPiece(const TCPIECE &Piece)
+	/*!
+		フィールド上から指定されたピースを取り除きます。
+		SetPiece で配置したピースを、ラインを取り除く前に元に戻すときに使用します。
+		@param[in] Piece 取り除くピース
+		@return フィールド
+	*/
+	TCFIELDT	&UnsetPiece(const TCPIECE &Piece)
 	{
 		UnsetPiece(Piece, Piece.m_Pos);
+		return *this;
 
 	} // end of TCFIELD::UnsetPiece
 
-	void	UnsetPiece(const TCPIECE &Piece, const TCPOS &Pos)
+	/*!
+		フィールド上から指定されたピースを取り除きます。
+		@param[in] Piece 取り除くピース（ただし位置は参照されない）
+		@param[in] Pos 取り除く位置
+		@return フィールド
+	*/
+	TCFIELDT	&UnsetPiece(const TCPIECE &Piece, const TCPOS &Pos)
 	{
-		std::vector<uint32_t>	bitmap = TCPIECE::GetBitmap(Piece);
+		const ROW	*mask = TCPIECE::GetRowMask<ROW>(Piece.m_Fig, Piece.m_Rot, Pos.GetX());
 		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
 			if ((1 <= Pos.GetY() + yy) && (Pos.GetY() + yy < m_FieldSize.GetY() - 1)) {
-				m_Field[yy + Pos.GetY()] &= ~TCBIT::Shift(bitmap[yy], Pos.GetX());
+				m_Hash ^= TCHASH::GetRowKey(Pos.GetY() + yy, static_cast<ROW>(m_Field[ROW_GUARD + Pos.GetY() + yy] & mask[yy] & m_LineFilled));
+				m_Field[ROW_GUARD + Pos.GetY() + yy] &= static_cast<ROW>(~mask[yy]);
 			}
 		}
+		UpdateSpots_All();
+		return *this;
 
 	} // end of TCFIELD::UnsetPiece
+
+	/*!
+		フィールド上に指定されたピースを配置し、揃ったラインを取り除きます。
+		SetPiece と RemoveLines を続けて実行するのと同じ結果になりますが、
+		変更前の状態に戻すための記録を返します。
+		揃ったラインは、配置したピースがかかる段だけを調べて求めます（配置する前のフィールドに揃ったラインがないことが前提です）。
+		探索のように、フィールドをコピーせずに同じフィールド上で配置を試すときに使用します。
+		@param[in] Piece 配置するピース
+		@return 変更前の状態に戻すための記録（UnmakeMove に渡す）
+	*/
+	UNDO	MakeMove(const TCPIECE &Piece)
+	{
+		UNDO	Undo;
+		Undo.m_PosY = Piece.m_Pos.GetY();
+		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
+			if ((1 <= Undo.m_PosY + yy) && (Undo.m_PosY + yy < m_FieldSize.GetY() - 1)) {
+				Undo.m_Rows[yy] = m_Field[ROW_GUARD + Undo.m_PosY + yy];
+			}
+		}
+		memcpy(Undo.m_Height, m_Height, sizeof(m_Height));
+		memcpy(Undo.m_Spots, m_Spots, sizeof(m_Spots));
+		Undo.m_SpotCount = m_SpotCount;
+		Undo.m_Hash = m_Hash;
+#if TCFIELD_COLUMNS
+		memcpy(Undo.m_Column, m_Column, sizeof(m_Column));
+#endif
+
+		SetPiece(Piece);
+		Undo.m_LinesMask = GetLinesMask(Piece);
+		RemoveLines(Undo.m_LinesMask);
+		return Undo;
+
+	} // end of TCFIELD::MakeMove
+
+	/*!
+		MakeMove で変更したフィールドを、変更前の状態に戻します。
+		複数回 MakeMove したときは、逆の順序で UnmakeMove しなければなりません。
+		@param[in] Undo MakeMove が返した記録
+		@return フィールド
+	*/
+	TCFIELDT	&UnmakeMove(const UNDO &Undo)
+	{
+		if (Undo.m_LinesMask) {
+			// 取り除いたラインを挿し戻す（地面の段は１段が埋まった状態と同じ）
+			ROW			LineFull = m_Field[ROW_GUARD + 0];
+			size_t		Removed = TCBIT::Count(Undo.m_LinesMask);
+			for (int8_t yy = m_FieldSize.GetY() - 2; yy >= 1; yy--) {
+				if (Undo.m_LinesMask & TCBIT::Get(yy)) {
+					m_Field[ROW_GUARD + yy] = LineFull;
+					Removed--;
+				} else {
+					m_Field[ROW_GUARD + yy] = m_Field[ROW_GUARD + yy - Removed];
+				}
+			}
+		}
+
+		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
+			if ((1 <= Undo.m_PosY + yy) && (Undo.m_PosY + yy < m_FieldSize.GetY() - 1)) {
+				m_Field[ROW_GUARD + Undo.m_PosY + yy] = Undo.m_Rows[yy];
+			}
+		}
+		memcpy(m_Height, Undo.m_Height, sizeof(m_Height));
+		memcpy(m_Spots, Undo.m_Spots, sizeof(m_Spots));
+		m_SpotCount = Undo.m_SpotCount;
+		m_Hash = Undo.m_Hash;
+#if TCFIELD_COLUMNS
+		memcpy(m_Column, Undo.m_Column, sizeof(m_Column));
 #endif
+		return *this;
+
+	} // end of TCFIELD::UnmakeMove
 
 	/*!
 		フィールド上で揃っているラインの数を数えます。
@@ -307,33 +775,89 @@ public:
 	*/
 	int8_t	CheckLines() const
 	{
-		int8_t	Lines = 0;
+		return static_cast<int8_t>(TCBIT::Count(GetLinesMask()));
+
+	} // end of TCFIELD::CheckLines
+
+	/*!
+		フィールド全体を走査して、揃っているラインの位置を求めます。
+		@return 揃っているラインの位置（bitN が Y=N の段に対応）
+	*/
+	uint32_t	GetLinesMask() const
+	{
+		uint32_t	LinesMask = 0;
 		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
-			if ((~m_Field[yy] & m_LineFilled) == 0) {
-				Lines++;
+			if ((~m_Field[ROW_GUARD + yy] & m_LineFilled) == 0) {
+				LinesMask |= TCBIT::Get(yy);
 			}
 		}
-		return Lines;
+		return LinesMask;
 
-	} // end of TCFIELD::CheckLines
+	} // end of TCFIELD::GetLinesMask
+
+	/*!
+		指定されたピースがかかる段だけを調べて、揃っているラインの位置を求めます。
+		配置する前のフィールドに揃ったラインがなければ、SetPiece した直後に呼ぶとフィールド全体を走査したのと同じ結果になります。
+		@param[in] Piece 最後に配置したピース
+		@return 揃っているラインの位置（bitN が Y=N の段に対応）
+	*/
+	uint32_t	GetLinesMask(const TCPIECE &Piece) const
+	{
+		int8_t		PosY = Piece.m_Pos.GetY();
+		uint32_t	LinesMask = 0;
+		for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
+			if ((1 <= PosY + yy) && (PosY + yy < m_FieldSize.GetY() - 1)) {
+				if ((~m_Field[ROW_GUARD + PosY + yy] & m_LineFilled) == 0) {
+					LinesMask |= TCBIT::Get(PosY + yy);
+				}
+			}
+		}
+		return LinesMask;
+
+	} // end of TCFIELD::GetLinesMask
 
 	/*!
 		フィールド上で揃っているラインを取り除き、間を詰めます。
+		フィールド全体を走査して揃っているラインを求めるので、揃っているラインの位置がわかっているときは RemoveLines(LinesMask) を使用してください。
 		@return フィールド
 	*/
-	TCFIELD	&RemoveLines()
+	TCFIELDT	&RemoveLines()
 	{
-		int8_t	Filled = 0;
-		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
-			if ((~m_Field[yy] & m_LineFilled) == 0) {
+		return RemoveLines(GetLinesMask());
+
+	} // end of TCFIELD::RemoveLines
+
+	/*!
+		指定された位置の（揃っている）ラインを取り除き、間を詰めます。
+		取り除く最も下の段より下は変化しないので、そこから上だけを詰めます。
+		ハッシュ値は、取り除いた段と、それより上で位置が変わった段の分だけ更新します。
+		@param[in] LinesMask 取り除くラインの位置（GetLinesMask の戻り値）
+		@return フィールド
+	*/
+	TCFIELDT	&RemoveLines(uint32_t LinesMask)
+	{
+		LinesMask &= TCBIT::GetMask(m_FieldSize.GetY() - 1) & ~TCBIT::Get(0);	// 枠（地面・天井）の段は取り除かない
+		if (LinesMask == 0) {
+			return *this;
+		}
+
+		int8_t		Filled = 0;
+		for (int8_t yy = static_cast<int8_t>(TCBIT::FindLowest(LinesMask)); yy < m_FieldSize.GetY() - 1; yy++) {
+			ROW		Cells = static_cast<ROW>(m_Field[ROW_GUARD + yy] & m_LineFilled);
+			if (LinesMask & TCBIT::Get(yy)) {
 				Filled++;
+				m_Hash ^= TCHASH::GetRowKey(yy, Cells);
 				continue;
 			}
-			m_Field[yy - Filled] = m_Field[yy];
+			if (Cells) {
+				m_Hash ^= TCHASH::GetRowKey(yy, Cells) ^ TCHASH::GetRowKey(yy - Filled, Cells);
+			}
+			m_Field[ROW_GUARD + yy - Filled] = m_Field[ROW_GUARD + yy];
 		}
 		for (int8_t yy = 0; yy < Filled; yy++) {
-			m_Field[m_FieldSize.GetY() - 2 - yy] &= ~m_LineFilled;
+			m_Field[ROW_GUARD + m_FieldSize.GetY() - 2 - yy] &= static_cast<ROW>(~m_LineFilled);
 		}
+		UpdateSpots_Remove(LinesMask);
 		return *this;
 
 	} // end of TCFIELD::RemoveLines
@@ -341,22 +865,203 @@ public:
 	/*!
 		フィールドにあるスポットの数を数えます。
 		スポットとは、埋まっていないマスのうち、その上側に１つ以上の埋まっているマスが存在するものを指します。
+		スポット数は差分で更新しているので、フィールドを走査することはありません。
 		@return 空いているスポット数
 	*/
 	size_t	CountSpots() const
 	{
-		size_t		Value = 0;
-		uint32_t	mask = 0;
+		return m_SpotCount;
+
+	} // end of TCFIELD::CountSpots
+
+	/*!
+		フィールドのハッシュ値を取得します。
+		枠の内側の埋まっているマスが同じフィールドは、幅・高さ・１段の整数型によらず同じハッシュ値になります。
+		ハッシュ値は SetPiece・RemoveLines などに合わせて差分で更新しているので、フィールドを走査することはありません。
+		評価値のキャッシュや、同じ局面の検出に使用できます。
+		@return ハッシュ値
+	*/
+	uint64_t	GetHash() const
+	{
+		return m_Hash;
+
+	} // end of TCFIELD::GetHash
+
+private:
+	/*!
+		GetHitMap と同じですが、番兵段を含めて範囲チェックなしで読み出します。
+		PosY は -ROW_GUARD～フィールド高さ+1 でなければなりません。
+		@param[in] PosY 縦位置（Y 値）
+		@param[in] CellX ピースの各マス（４つ）の、ピースの最も右の列からの横の距離
+		@param[in] CellY ピースの各マス（４つ）の縦の距離
+		@return ぶつかる位置のビットマップ（bitN が、ピースの最も右の列を X=N に置いた場合）
+	*/
+	ROW		GetHitMap_Guarded(int8_t PosY, const int8_t CellX[TCPIECE::PIECE_WIDTH], const int8_t CellY[TCPIECE::PIECE_WIDTH]) const
+	{
+		const ROW	*Rows = &m_Field[ROW_GUARD + PosY];
+		return static_cast<ROW>(
+			(Rows[CellY[0]] >> CellX[0]) |
+			(Rows[CellY[1]] >> CellX[1]) |
+			(Rows[CellY[2]] >> CellX[2]) |
+			(Rows[CellY[3]] >> CellX[3])
+		);
+
+	} // end of TCFIELD::GetHitMap_Guarded
+
+
+	/*!
+		フィールド全体を走査して、ハッシュ値を求め直します。
+	*/
+	void	UpdateHash_All()
+	{
+		m_Hash = 0;
+		for (int8_t yy = 1; yy < m_FieldSize.GetY() - 1; yy++) {
+			m_Hash ^= TCHASH::GetRowKey(yy, static_cast<ROW>(m_Field[ROW_GUARD + yy] & m_LineFilled));
+		}
+
+	} // end of TCFIELD::UpdateHash_All
+
+	/*!
+		フィールド全体を走査して、列ごとの高さと段ごとのスポット数（と列ごとのビットマップ）を求め直します。
+	*/
+	void	UpdateSpots_All()
+	{
+		memset(m_Height, 0, sizeof(m_Height));
+		memset(m_Spots, 0, sizeof(m_Spots));
+		m_SpotCount = 0;
+#if TCFIELD_COLUMNS
+		memset(m_Column, 0, sizeof(m_Column));
+		for (int8_t xx = 1; xx < m_FieldSize.GetX() - 1; xx++) {
+			m_Column[xx] = TCBIT::Get(0);
+		}
+#endif
+
+		ROW		mask = 0;
 		for (int8_t yy = m_FieldSize.GetY() - 2; yy >= 1; yy--) {
-			uint32_t	bitmap = m_Field[yy] & m_LineFilled;
-			Value += TCBIT::Count(~bitmap & mask, m_FieldSize.GetX());
+			ROW		bitmap = m_Field[ROW_GUARD + yy] & m_LineFilled;
+			for (ROW top = static_cast<ROW>(bitmap & ~mask); top; top &= top - 1) {
+				m_Height[BIT::FindLowest(top)] = yy;
+			}
+#if TCFIELD_COLUMNS
+			for (ROW cells = bitmap; cells; cells &= cells - 1) {
+				m_Column[BIT::FindLowest(cells)] |= TCBIT::Get(yy);
+			}
+#endif
+			m_Spots[yy] = static_cast<int8_t>(BIT::Count(static_cast<ROW>(~bitmap & mask)));
+			m_SpotCount += m_Spots[yy];
 			mask |= bitmap;
 		}
-		return Value;
 
-	} // end of TCFIELD::CountSpots
+	} // end of TCFIELD::UpdateSpots_All
+
+	/*!
+		ピースの配置によって新たに埋まったマスについて、列ごとの高さと段ごとのスポット数（と列ごとのビットマップ）を更新します。
+		ピースが覆う段については、下の段から順に呼び出さなければなりません。
+		@param[in] PosY 縦位置（Y 値、1～フィールド高さ）
+		@param[in] Cells 新たに埋まったマスのビットマップ
+	*/
+	void	UpdateSpots_Set(int8_t PosY, ROW Cells)
+	{
+		for (; Cells; Cells &= Cells - 1) {
+			int8_t	xx = static_cast<int8_t>(BIT::FindLowest(Cells));
+			ROW		bit = BIT::Get(xx);
+#if TCFIELD_COLUMNS
+			m_Column[xx] |= TCBIT::Get(PosY);
+#endif
+
+			if (PosY < m_Height[xx]) {
+				// スポットが埋まった
+				m_Spots[PosY]--;
+				m_SpotCount--;
+				continue;
+			}
+
+			// 列が高くなったので、元の高さとの間の空きマスがスポットになる
+			for (int8_t yy = m_Height[xx] + 1; yy < PosY; yy++) {
+				if ((m_Field[ROW_GUARD + yy] & bit) == 0) {
+					m_Spots[yy]++;
+					m_SpotCount++;
+				}
+			}
+			m_Height[xx] = PosY;
+		}
+
+	} // end of TCFIELD::UpdateSpots_Set
+
+	/*!
+		ラインを取り除いて間を詰めた後に、列ごとの高さと段ごとのスポット数（と列ごとのビットマップ）を更新します。
+		揃っていた段にはスポットがないので、段ごとのスポット数はビットマップと同じように詰めるだけです。
+		最も上のマスが取り除かれた列だけは、その下の空きマスがスポットでなくなるので、次に埋まっているマスまで走査します。
+		列ごとのビットマップを保持しているときは、取り除いた段のビットを抜いて詰めた後、新しい高さを TCBIT::FindHighest で求めます。
+		@param[in] LinesMask 取り除いたラインの位置（bitN が取り除く前の Y=N の段に対応）
+	*/
+	void	UpdateSpots_Remove(uint32_t LinesMask)
+	{
+		int8_t	Filled = 0;
+		for (int8_t yy = static_cast<int8_t>(TCBIT::FindLowest(LinesMask)); yy < m_FieldSize.GetY() - 1; yy++) {
+			if (LinesMask & TCBIT::Get(yy)) {
+				Filled++;
+				continue;
+			}
+			m_Spots[yy - Filled] = m_Spots[yy];
+		}
+		for (int8_t yy = 0; yy < Filled; yy++) {
+			m_Spots[m_FieldSize.GetY() - 2 - yy] = 0;
+		}
+
+#if TCFIELD_COLUMNS
+		// 上の段から順に、取り除いた段のビットを抜いて詰める
+		for (uint32_t Lines = LinesMask; Lines; ) {
+			size_t		yy = TCBIT::FindHighest(Lines);
+			uint32_t	below = TCBIT::GetMask(yy);
+			Lines &= ~TCBIT::Get(yy);
+			for (int8_t xx = 1; xx < m_FieldSize.GetX() - 1; xx++) {
+				m_Column[xx] = (m_Column[xx] & below) | ((m_Column[xx] >> 1) & ~below);
+			}
+		}
+
+		for (int8_t xx = 1; xx < m_FieldSize.GetX() - 1; xx++) {
+			int8_t	Height = m_Height[xx];
+			int8_t	NewHeight = static_cast<int8_t>(TCBIT::FindHighest(m_Column[xx]));
+			if ((Height > 0) && (LinesMask & TCBIT::Get(Height))) {
+				// 最も上のマスが取り除かれたので、新しい高さより上の空きマスはスポットでなくなる
+				for (int8_t yy = Height - static_cast<int8_t>(TCBIT::Count(LinesMask, Height + 1)); yy > NewHeight; yy--) {
+					m_Spots[yy]--;
+					m_SpotCount--;
+				}
+			}
+			m_Height[xx] = NewHeight;
+		}
+#else
+		for (int8_t xx = 1; xx < m_FieldSize.GetX() - 1; xx++) {
+			int8_t	Height = m_Height[xx];
+			int8_t	Below = static_cast<int8_t>(TCBIT::Count(LinesMask, Height + 1));	// 高さ以下で取り除いたライン数
+			if (Below == 0) {
+				continue;
+			}
+			if ((LinesMask & TCBIT::Get(Height)) == 0) {
+				m_Height[xx] = Height - Below;
+				continue;
+			}
+
+			ROW			bit = BIT::Get(xx);
+			int8_t		yy = Height - Below;
+			while ((yy >= 1) && ((m_Field[ROW_GUARD + yy] & bit) == 0)) {
+				m_Spots[yy]--;
+				m_SpotCount--;
+				yy--;
+			}
+			m_Height[xx] = yy;
+		}
+#endif
+
+	} // end of TCFIELD::UpdateSpots_Remove
 };
 
+typedef TCFIELDT<uint16_t>	TCFIELD16;	//!< 幅 14 までのフィールド
+typedef TCFIELDT<uint32_t>	TCFIELD;	//!< 幅 30 までのフィールド（標準）
+typedef TCFIELDT<uint64_t>	TCFIELD64;	//!< 幅 62 までのフィールド
+
 
 
 //----------------------------------------------------------------------------
@@ -32,34 +32,257 @@
 #include <windows.h>
 #include <winsock2.h>
 #pragma comment(lib, "ws2_32.lib")	// for gethostname
-#include <list>
 #include <map>
 #include <string>
 #include <strstream>
 #include <vector>
 #include "tctype.h"
+#include "tcbit.h"
+#include "tceventqueue.h"
+#include "tcpiececorpus.h"
+#include "tcpiecesequence.h"
 #include "tcplayerdll.h"
 #include "tcplayfield.h"
+#include "tcplayfieldbatch.h"
 #include "tcrandomgenerator.h"
 #include "tcstreamwriter.h"
 #include "tcstreamwriter_file.h"
 #include "tcstring.h"
 #include "tcstringlist.h"
+#include "tcthreadpool.h"
 #include "tcview.h"
 #include "tcview_console.h"
+#include "tcview_null.h"
 
 //----------------------------------------------------------------------------
 /*!
 	FIXME
 */
-class TCGAMECONTROL
+class TCGAMECONTROL : private TCTHREADPOOL::LISTENER
 {
 	//
 	// assign
 	//
-	typedef std::map<TCPLAYFIELD*, TCPLAYERDLL*>	GAMECONTENT;
-	typedef std::pair<TCPLAYFIELD*, TCEVENT>		EVENTX;
-	typedef std::list<EVENTX>						EVENTQUEUE;
+	typedef TCEVENTQUEUE::EVENTX					EVENTX;
+	typedef TCEVENTQUEUE							EVENTQUEUE;
+	typedef std::pair<TCPLAYFIELD*, TCPLAYERDLL*>	ENTRY;
+
+	static const size_t		FAST_FORWARD_FRAME = 1000;	//!< 早送りで一度に進行させるフレーム数の上限
+	static const size_t		EVENTQUEUE_SIZE = 1024;		//!< 描画までにためておけるイベントの数
+
+
+private:
+	/*!
+		並列実行モードで、１ラウンド・１プレイヤ分のゲームを実行するタスクです。
+		プレイフィールドはタスクごとに専用のものを持ち、タスクと一緒に破棄されます。
+		プレイヤのインスタンスは実行中だけ生成するので、同時に存在するインスタンスはスレッド数までに抑えられます。
+	*/
+	class ROUNDTASK : public TCTHREADPOOL::TASK
+	{
+		//
+		// variable
+		//
+	public:
+		TCPLAYFIELD				*m_pPlayField;	//!< このタスク専用のプレイフィールド
+		std::string				m_LibName;		//!< プレイヤの DLL のファイル名
+		size_t					m_InstanceId;	//!< プレイヤに渡すインスタンス ID
+		const std::string		*m_pRule;		//!< プレイヤに渡すルール（全タスクで共有する）
+		const TCPIECESEQUENCE	*m_pSequence;	//!< ラウンドのピース列（同じラウンドのタスクで共有する）
+		size_t					m_Round;		//!< ラウンド数（1～）
+		bool					m_bFastForward;	//!< 変化のないフレームを早送りするかどうか
+		size_t					m_FrameCount;	//!< 進行させたフレーム数
+
+		//
+		// method
+		//
+	public:
+		ROUNDTASK(TCPLAYFIELD *pPlayField, const std::string &LibName, size_t InstanceId, const std::string *pRule, const TCPIECESEQUENCE *pSequence, size_t Round, bool bFastForward)
+			: m_pPlayField(pPlayField),
+			m_LibName(LibName),
+			m_InstanceId(InstanceId),
+			m_pRule(pRule),
+			m_pSequence(pSequence),
+			m_Round(Round),
+			m_bFastForward(bFastForward),
+			m_FrameCount(0)
+		{
+			TCASSERT(m_pPlayField != NULL, "alloc null.");
+			TCASSERT(m_pRule != NULL, "fatal.");
+			TCASSERT(m_pSequence != NULL, "fatal.");
+
+		} // end of TCGAMECONTROL::ROUNDTASK::ctor
+
+		~ROUNDTASK()
+		{
+			delete m_pPlayField;
+			m_pPlayField = NULL;
+
+		} // end of TCGAMECONTROL::ROUNDTASK::dtor
+
+		void	Exec()
+		{
+			// DLL はメインスレッドで開いたままにしてあるので、ここではインスタンスの生成と破棄だけになる
+			TCPLAYERDLL	PlayerDll(m_LibName.c_str(), m_InstanceId);
+			if (!PlayerDll.Open(m_pRule->c_str())) {
+				// ゲームを開始しないので、このラウンドはスコアなしの結果になる
+				TCVERBOSE("open failed.");
+				return;
+			}
+
+			m_pPlayField->StartGame(*m_pSequence, PlayerDll.Get());
+			while (m_pPlayField->IsPlaying()) {
+				if (m_bFastForward) {
+					size_t	Frames = 0;
+					m_pPlayField->Tick(PlayerDll.Get(), FAST_FORWARD_FRAME, Frames);
+					m_FrameCount += Frames;
+				} else {
+					m_pPlayField->Tick(PlayerDll.Get());
+					m_FrameCount++;
+				}
+			}
+
+		} // end of TCGAMECONTROL::ROUNDTASK::Exec
+	};
+
+	/*!
+		プレイフィールドとプレイヤの組を、登録順に番号（0～）で参照できるよう、連続した領域に保持するコンテナです。
+		プレイ中のプレイフィールドをビットセットで管理するので、全体がプレイ中かどうかは一定時間で判断でき、
+		プレイ中のものだけを順に辿ることもできます。
+	*/
+	class GAMECONTENT
+	{
+		//
+		// variable
+		//
+	private:
+		std::vector<TCPLAYFIELD>	m_PlayFields;	//!< 登録順のプレイフィールド
+		std::vector<TCPLAYERDLL*>	m_PlayerDlls;	//!< 登録順のプレイヤ
+		std::vector<uint32_t>		m_Playing;		//!< プレイ中のプレイフィールドのビットセット（番号 idx は idx / 32 番目の要素の idx % 32 ビット目）
+		size_t						m_PlayingCount;	//!< プレイ中のプレイフィールドの数
+
+		//
+		// method
+		//
+	private:
+		GAMECONTENT(const GAMECONTENT &);
+		GAMECONTENT	&operator=(const GAMECONTENT &);
+
+	public:
+		GAMECONTENT()
+			: m_PlayFields(),
+			m_PlayerDlls(),
+			m_Playing(),
+			m_PlayingCount(0)
+		{
+		} // end of TCGAMECONTROL::GAMECONTENT::ctor
+
+		~GAMECONTENT()
+		{
+			for (size_t ii = 0; ii < m_PlayerDlls.size(); ii++) {
+				delete m_PlayerDlls[ii];
+				m_PlayerDlls[ii] = NULL;
+			}
+
+		} // end of TCGAMECONTROL::GAMECONTENT::dtor
+
+		/*!
+			プレイフィールドとプレイヤの組を登録します。
+			登録した組の参照は、次に登録するまで有効です。
+			@param[in] PlayField プレイフィールド（コピーして保持する）
+			@param[in] pPlayerDll プレイヤ（コンテナが破棄する）
+		*/
+		void	Add(const TCPLAYFIELD &PlayField, TCPLAYERDLL *pPlayerDll)
+		{
+			TCASSERT(pPlayerDll != NULL, "alloc null.");
+
+			m_PlayFields.push_back(PlayField);
+			m_PlayerDlls.push_back(pPlayerDll);
+			m_Playing.resize((m_PlayFields.size() + 31) / 32, 0);
+			Update(m_PlayFields.size() - 1);
+
+		} // end of TCGAMECONTROL::GAMECONTENT::Add
+
+		/*!
+			登録されている組の数を返します。
+			@return 組の数
+		*/
+		size_t	GetCount() const
+		{
+			return m_PlayFields.size();
+
+		} // end of TCGAMECONTROL::GAMECONTENT::GetCount
+
+		TCPLAYFIELD	&GetPlayField(size_t idx)
+		{
+			return m_PlayFields[idx];
+
+		} // end of TCGAMECONTROL::GAMECONTENT::GetPlayField
+
+		const TCPLAYFIELD	&GetPlayField(size_t idx) const
+		{
+			return m_PlayFields[idx];
+
+		} // end of TCGAMECONTROL::GAMECONTENT::GetPlayField
+
+		TCPLAYERDLL	*GetPlayerDll(size_t idx) const
+		{
+			return m_PlayerDlls[idx];
+
+		} // end of TCGAMECONTROL::GAMECONTENT::GetPlayerDll
+
+		/*!
+			いずれかのプレイフィールドがプレイ中かどうかを返します。
+			@retval true プレイ中のものがある
+			@retval false すべて終わった
+		*/
+		bool	IsPlaying() const
+		{
+			return m_PlayingCount > 0;
+
+		} // end of TCGAMECONTROL::GAMECONTENT::IsPlaying
+
+		/*!
+			指定された番号以降で、最初にプレイ中のプレイフィールドの番号を返します。
+			@param[in] idx 探し始める番号（0～）
+			@return プレイフィールドの番号（ないときは GetCount()）
+		*/
+		size_t	FindPlaying(size_t idx) const
+		{
+			for (size_t word = idx / 32; word < m_Playing.size(); word++) {
+				uint32_t	bitmap = m_Playing[word];
+				if (word == idx / 32) {
+					bitmap &= ~TCBIT::GetMask(idx % 32);
+				}
+				if (bitmap != 0) {
+					return word * 32 + TCBIT::FindLowest(bitmap);
+				}
+			}
+			return GetCount();
+
+		} // end of TCGAMECONTROL::GAMECONTENT::FindPlaying
+
+		/*!
+			プレイフィールドを進行させた後に呼び、ビットセットをプレイフィールドの状態に合わせます。
+			@param[in] idx プレイフィールドの番号（0～）
+		*/
+		void	Update(size_t idx)
+		{
+			uint32_t	&bitmap = m_Playing[idx / 32];
+			uint32_t	bit = TCBIT::Get(idx % 32);
+			bool		bPlaying = m_PlayFields[idx].IsPlaying();
+			if (bPlaying == ((bitmap & bit) != 0)) {
+				return;
+			}
+			if (bPlaying) {
+				bitmap |= bit;
+				m_PlayingCount++;
+			} else {
+				bitmap &= ~bit;
+				m_PlayingCount--;
+			}
+
+		} // end of TCGAMECONTROL::GAMECONTENT::Update
+	};
 
 
 private:
@@ -77,6 +300,7 @@ private:
 		static const uint8_t		CHR_FRAME = '#';
 		static const uint8_t		CHR_BLOCK = '@';
 		static const uint8_t		CHR_PIECE = 'X';
+		static const size_t			DRAW_EVENT_MAX = 64;	// １回の Draw で取り出すイベントの数の上限
 
 		//
 		// variable
@@ -84,6 +308,10 @@ private:
 	private:
 		TCVIEW						*m_pView;
 		std::map<std::string, size_t>	m_Effect;
+		ssize_t						m_DrawCount;	// Draw した回数（ゲームオーバー表示の点滅用）
+		ssize_t						m_BgOfs;		// 背景のアニメーション位置
+		ssize_t						m_RoundOfs;		// ラウンド表示のスクロール位置
+		EVENTX						m_Events[DRAW_EVENT_MAX];	// Draw でキューから取り出したイベント
 
 		//
 		// method
@@ -91,7 +319,10 @@ private:
 	public:
 		VIEW(TCVIEW *pView)
 			: m_pView(pView),
-			m_Effect()
+			m_Effect(),
+			m_DrawCount(0),
+			m_BgOfs(0),
+			m_RoundOfs(0)
 		{
 			TCASSERT(m_pView != NULL, "alloc null.");
 
@@ -116,14 +347,21 @@ private:
 
 		} // end of TCGAMECONTROL::VIEW::StartEffect
 
+		/*!
+			画面を描画します。
+			キューからは DRAW_EVENT_MAX 個までのイベントを取り出して消費するので、描画が間に合わないときは、古いイベントがキューから溢れて捨てられます。
+			@param[in] container プレイフィールドとプレイヤの組
+			@param[in] round 現在のラウンド数
+			@param[in/out] queue 前回の描画以降に発生したイベント
+		*/
 		void	Draw(const GAMECONTENT &container, size_t round, EVENTQUEUE &queue)
 		{
 			TCASSERT(m_pView != NULL, "fatal error.");
 
+			size_t	EventCount = queue.Drain(m_Events, DRAW_EVENT_MAX);
+
 			m_pView->Clear();
 			{
-				static ssize_t	cnt = 0;
-
 				if (IsDrawingEffect("RoundStart")) {
 					Draw_RoundStart(TCVIEW::LOCATOR(0, 0, 0), round);
 				} else {
@@ -133,60 +371,57 @@ private:
 
 				TCVIEW::LOCATOR	myloc(PLAYFIELD_POS_X, PLAYFIELD_POS_Y, 0);
 
-				for (GAMECONTENT::const_iterator it = container.begin(); it != container.end(); ++it) {
+				for (size_t index = 0; index < container.GetCount(); index++) {
+					TCPLAYFIELD::SNAPSHOT	State = container.GetPlayField(index).GetSnapshot();
 					bool bGameOver = (
-						!it->first->IsPlaying() &&
-						((cnt & 0x1f) < 0x18)
+						!State.IsPlaying() &&
+						((m_DrawCount & 0x1f) < 0x18)
 					);
 					Draw_PlayField(
 						myloc,
 						bGameOver,
-						it->first->GetScore(),
-						it->first->GetField(),
-						it->first->GetCtrlPiece(),
-						it->first->GetNextPiece(),
-						it->second->Get()
+						State.GetScore(),
+						State.GetField(),
+						State.GetCtrlPiece(),
+						State.GetNextPiece(),
+						container.GetPlayerDll(index)->Get()
 					);
 					if (false) {	// FIXME
-#if 1
-						while (queue.begin() != queue.end()) {
-							if (queue.begin()->first != it->first) {
-								break;
+						size_t	count = 0;
+						for (size_t ii = 0; ii < EventCount; ii++) {
+							if (m_Events[ii].first == index) {
+								m_pView->DrawFont(myloc + TCVIEW::LOCATOR(1, 0, 0), 'v');
+								count++;
 							}
-							m_pView->DrawFont(myloc + TCVIEW::LOCATOR(1, 0, 0), 'v');
-							queue.pop_front();
 						}
-#endif
-						m_pView->DrawFont(myloc + TCVIEW::LOCATOR(0, 0, 0), "0123456789"[queue.size()]);
+						m_pView->DrawFont(myloc + TCVIEW::LOCATOR(0, 0, 0), "0123456789"[min(count, 9)]);
 					}
 					myloc += TCVIEW::LOCATOR(PLAYFIELD_WIDTH, 0, 0);
 				}
-				cnt++;
+				m_DrawCount++;
 			}
 			m_pView->Paint();
 
 		} // end of TCGAMECONTROL::VIEW::Draw
 
-		void	Draw_Bg() const
+		void	Draw_Bg()
 		{
 			TCASSERT(m_pView != NULL, "fatal error.");
 
-			static ssize_t	ofs = 0;
 			ssize_t	sizeX = m_pView->GetSize().GetX();
 			ssize_t	sizeY = m_pView->GetSize().GetY();
 
-			ofs++;
+			m_BgOfs++;
 			for (ssize_t ii = 0; ii < sizeX; ii++) {
-				m_pView->DrawFont(TCVIEW::LOCATOR(ii, sizeY - ((ofs + (sizeX - ii)) % sizeY), 0), "-/|\\"[ofs & 0x00000003U]);
+				m_pView->DrawFont(TCVIEW::LOCATOR(ii, sizeY - ((m_BgOfs + (sizeX - ii)) % sizeY), 0), "-/|\\"[m_BgOfs & 0x00000003U]);
 			}
 
 		} // end of TCGAMECONTROL::VIEW::Draw_Bg
 
-		void	Draw_Round(const TCVIEW::LOCATOR &loc, size_t round) const
+		void	Draw_Round(const TCVIEW::LOCATOR &loc, size_t round)
 		{
 			TCASSERT(m_pView != NULL, "fatal error.");
 
-			static ssize_t	ofs = 0;
 			ssize_t	sizeX = m_pView->GetSize().GetX();
 
 			std::strstream	ss;
@@ -198,13 +433,13 @@ private:
 			std::string		content(ss.str());
 
 			ssize_t	size = static_cast<ssize_t>(content.size());
-			TCVIEW::LOCATOR	myloc = loc + TCVIEW::LOCATOR(-(ofs % size), 0, 0);
+			TCVIEW::LOCATOR	myloc = loc + TCVIEW::LOCATOR(-(m_RoundOfs % size), 0, 0);
 
 			for (ssize_t ii = 0; ii < sizeX + size; ii += size) {
 				m_pView->DrawFont(myloc, content);
 				myloc += TCVIEW::LOCATOR(size, 0, 0);
 			}
-			ofs++;
+			m_RoundOfs++;
 
 		} // end of TCGAMECONTROL::VIEW::Draw_Round
 
@@ -277,16 +512,17 @@ private:
 
 		} // end of TCGAMECONTROL::VIEW::Draw_Field
 
-		void	Draw_Piece(const TCVIEW::LOCATOR &locFO, const TCPIECE Piece) const
+		void	Draw_Piece(const TCVIEW::LOCATOR &locFO, const TCPIECE &Piece) const
 		{
 			TCASSERT(m_pView != NULL, "fatal error.");
 
 			if (Piece.m_Fig == TCPIECE::FIG_VOID) {
 				return;
 			}
+			const uint32_t	*bitmap = TCPIECE::GetMask(Piece.m_Fig, Piece.m_Rot, 0);
 			for (int8_t yy = 0; yy < TCPIECE::PIECE_WIDTH; yy++) {
 				uint32_t	mask = 1 << 0;
-				uint32_t	line = Piece.GetBitmap()[yy];
+				uint32_t	line = bitmap[yy];
 				for (int8_t xx = 0; xx < TCPIECE::PIECE_WIDTH; xx++) {
 					if (line & mask) {
 						m_pView->Draw(locFO - TCVIEW::LOCATOR(Piece.m_Pos.GetX() + xx, Piece.m_Pos.GetY() + yy, 0), CHR_PIECE);
@@ -407,12 +643,24 @@ protected:
 	std::string					m_ReportDst;
 	std::string					m_Hostname;
 
-	EVENTQUEUE					m_Queue;
+	EVENTQUEUE					m_Queue;		// 描画までにためておくイベント（プレイフィールドの番号は m_Container の登録順）
 	size_t						m_SkipFrame;	// スキップするフレーム数（1～）
+	bool						m_bHeadless;	// 画面出力せずに最高速で実行するかどうか（ViewOpt の VIEW=NULL）
+	size_t						m_ThreadCount;	// ヘッドレスモードで、ラウンドを並列に実行するスレッド数（ViewOpt の T。2 以上で並列実行モード）
+	bool						m_bFastForward;	// ヘッドレスモードで、変化のないフレームを早送りするかどうか（ViewOpt の FF=1）
+	bool						m_bBatch;		// ヘッドレスモードで、全プレイフィールドをまとめて進行させるかどうか（ViewOpt の BATCH=1。逐次実行のみ）
+	size_t						m_FrameCount;	// 全ラウンドで進行させたフレーム数
+	size_t						m_PieceCount;	// 全ラウンド・全プレイヤで落下させたピース数
 
 	size_t						m_RoundCount;	// ラウンド数
 	size_t						m_Round;		// 現在のラウンド数
-	GAMECONTENT					m_Container;
+	GAMECONTENT					m_Container;	// 登録順のプレイフィールドとプレイヤの組
+	TCRANDOMGENERATOR			m_Seeder;		// ラウンドごとのピース列のシードを生成する乱数ジェネレータ（RuleOpt の SEED。0 または省略時は秒カウンタ）
+	TCPIECECORPUS				m_Corpus;		// ラウンドごとのピース列を読み出すコーパス（RuleOpt の CORPUS。省略時は開かず、m_Seeder から生成する）
+	TCPIECESEQUENCE				m_Sequence;		// 現在のラウンドのピース列（全プレイフィールドで共有する）
+	std::vector<std::string>	m_PlayerLibs;	// 登録順のプレイヤ DLL のファイル名（並列実行モードでタスクごとにインスタンスを生成するため）
+	std::vector<TCTHREADPOOL::TASK*>	*m_pRoundTasks;	// 並列実行モードで実行中のタスク（ラウンド順、同じラウンド内はプレイヤの登録順）
+	std::vector<size_t>			m_RoundDone;	// 並列実行モードで、ラウンドごとに終わったタスクの数
 
 	//
 	// method
@@ -435,34 +683,52 @@ public:
 		m_ViewList(ViewOpt),
 		m_ReportDst(TCSTRING::Embed(ReportDst)),
 		m_Hostname(GetHostname()),
-		m_Queue(),
+		m_Queue(EVENTQUEUE_SIZE),
 		m_SkipFrame(1),
+		m_bHeadless(false),
+		m_ThreadCount(1),
+		m_bFastForward(false),
+		m_bBatch(false),
+		m_FrameCount(0),
+		m_PieceCount(0),
 		m_RoundCount(0),
-		m_Container()
+		m_Container(),
+		m_Seeder(static_cast<uint32_t>(m_RuleList.GetInteger("SEED"))),
+		m_Corpus(),
+		m_Sequence(),
+		m_PlayerLibs(),
+		m_pRoundTasks(NULL),
+		m_RoundDone()
 	{
 		TCASSERT(m_RuleList.GetInteger("W") >= 4, "RuleOpt invalid.");
 		TCASSERT(m_RuleList.GetInteger("H") >= 4, "RuleOpt invalid.");
 		TCASSERT(m_RuleList.GetInteger("G") > 0, "RuleOpt invalid.");
 		TCASSERT(m_RuleList.GetInteger("R") > 0, "RuleOpt invalid.");
 
-		TCASSERT(m_ViewList.GetInteger("W") > 0, "ViewOpt invalid.");
-		TCASSERT(m_ViewList.GetInteger("H") > 0, "ViewOpt invalid.");
-		TCASSERT(m_ViewList.GetInteger("S") > 0, "ViewOpt invalid.");
+		m_bHeadless = (m_ViewList.GetString("VIEW") == "NULL");
+		if (m_bHeadless) {
+			m_ThreadCount = max(m_ViewList.GetInteger("T"), 1);
+			m_bFastForward = (m_ViewList.GetInteger("FF") != 0);
+			m_bBatch = (m_ViewList.GetInteger("BATCH") != 0);
+		} else {
+			TCASSERT(m_ViewList.GetInteger("W") > 0, "ViewOpt invalid.");
+			TCASSERT(m_ViewList.GetInteger("H") > 0, "ViewOpt invalid.");
+			TCASSERT(m_ViewList.GetInteger("S") > 0, "ViewOpt invalid.");
 
-		m_SkipFrame = m_ViewList.GetInteger("S");
+			m_SkipFrame = m_ViewList.GetInteger("S");
+		}
 		m_RoundCount = m_RuleList.GetInteger("R");
 
+		if (!m_RuleList.GetString("CORPUS").empty()) {
+			bool rv = m_Corpus.Open(m_RuleList.GetString("CORPUS").c_str());
+			TCASSERT(rv, "corpus not opened.");
+		}
+
 	} // end of TCGAMECONTROL::ctor
 
 	virtual ~TCGAMECONTROL()
 	{
-		for (GAMECONTENT::iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
-			delete it->first;
-//			it->first = NULL;	// MEMO: error C3892 が出てしまうため、ポインタのクリアは map::clear() に委譲した。
-			delete it->second;
-//			it->second = NULL;	// MEMO: error C3892 が出てしまうため、ポインタのクリアは map::clear() に委譲した。
-		}
-		m_Container.clear();
+		// プレイフィールドとプレイヤは m_Container が破棄する
 
 	} // end of TCGAMECONTROL::dtor
 
@@ -480,23 +746,61 @@ public:
 
 	} // end of TCGAMECONTROL::GetString
 
+	/*!
+		全ラウンド分のピース列を、コーパスとしてファイルに書き出します。
+		RuleOpt の SEED・R で実行したときと同じピース列になるので、その実行をコーパスで再現できます。
+		@param[in] strPath ファイル名
+		@retval true 成功
+		@retval false 失敗
+	*/
+	bool	MakeCorpus(const char *strPath)
+	{
+		std::vector<TCPIECESEQUENCE>	Sequences;
+		for (size_t round = 1; round <= m_RoundCount; round++) {
+			Sequences.push_back(MakeSequence(round));
+		}
+		return TCPIECECORPUS::Save(strPath, Sequences, TCPIECESEQUENCE::GetRoundCount());
+
+	} // end of TCGAMECONTROL::MakeCorpus
+
 	void	AddPlayer(const char *strLibName)
 	{
-		TCPLAYFIELD	*pPlayField = new TCPLAYFIELD(
+		TCPLAYFIELD	PlayField(
 			static_cast<int8_t>(m_RuleList.GetInteger("W")),
 			static_cast<int8_t>(m_RuleList.GetInteger("H")),
 			static_cast<int8_t>(m_RuleList.GetInteger("G"))
 		);
-		TCASSERT(pPlayField != NULL, "alloc null.");
 
-		TCPLAYERDLL	*pPlayerDll = new TCPLAYERDLL(strLibName);
+		// エントリーする
+		m_PlayerLibs.push_back(std::string(strLibName));
+
+		TCPLAYERDLL	*pPlayerDll = new TCPLAYERDLL(strLibName, GetInstanceId(m_PlayerLibs.size() - 1));
 		TCASSERT(pPlayerDll != NULL, "alloc null.");
 
-		// エントリーする
-		m_Container[pPlayField] = pPlayerDll;
+		m_Container.Add(PlayField, pPlayerDll);
 
 	} // end of TCGAMECONTROL::AddPlayer
 
+	/*!
+		全ラウンドで進行させたフレーム数を返します（Run の後に、実行速度を求めるために使用します）。
+		@return フレーム数
+	*/
+	size_t	GetFrameCount() const
+	{
+		return m_FrameCount;
+
+	} // end of TCGAMECONTROL::GetFrameCount
+
+	/*!
+		全ラウンド・全プレイヤで落下させたピース数を返します（Run の後に、実行速度を求めるために使用します）。
+		@return ピース数
+	*/
+	size_t	GetPieceCount() const
+	{
+		return m_PieceCount;
+
+	} // end of TCGAMECONTROL::GetPieceCount
+
 	void	Run()
 	{
 		// create view
@@ -508,13 +812,24 @@ public:
 			)
 		);
 
+		if (m_bHeadless && (m_ThreadCount > 1)) {
+			// プレイヤのインスタンスはタスクごとに生成する
+			Run_Parallel();
+			return;
+		}
+
 		// open player
 		OpenPlayer();
 
+		if (m_bHeadless) {
+			Run_Headless();
+			return;
+		}
+
 		for (m_Round = 1; m_Round <= m_RoundCount; m_Round++) {
 			// start game
-			m_Queue.resize(0);
-			m_Queue = StartGame();
+			m_Queue.Clear();
+			StartGame();
 			View.StartEffect("RoundStart");
 
 			// exec loop
@@ -523,8 +838,8 @@ public:
 				if (!View.IsDrawingEffect("RoundStart")) {
 					// エフェクトが非アクティブのときのみ、ゲームを進行させる
 					for (size_t ii = 0; ii < m_SkipFrame; ii++) {
-						EVENTQUEUE	queueTick = Tick();
-						m_Queue.insert(m_Queue.end(), queueTick.begin(), queueTick.end());
+						Tick();
+						m_FrameCount++;
 					}
 				}
 
@@ -539,8 +854,128 @@ public:
 	} // end of TCGAMECONTROL::Run
 
 private:
+	/*!
+		画面出力せずに、全ラウンドを最高速で実行します。
+		描画・エフェクト・描画用の文字列の整形をすべて省き、イベントも蓄積しません。
+		早送りするときは、プレイフィールドごとに最後まで進行させます。
+		まとめて進行させるときは、全プレイフィールドを TCPLAYFIELDBATCH で１フレームずつ揃えて進行させます（早送りより優先）。
+	*/
+	void	Run_Headless()
+	{
+		TCPLAYFIELDBATCH	Batch;
+		if (m_bBatch) {
+			for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+				Batch.Add(&m_Container.GetPlayField(idx), m_Container.GetPlayerDll(idx)->Get());
+			}
+		}
+
+		for (m_Round = 1; m_Round <= m_RoundCount; m_Round++) {
+			// start game
+			m_Queue.Clear();
+			StartGame();
+
+			// exec loop
+			if (m_bBatch) {
+				m_FrameCount += Tick_Batch(Batch);
+			} else if (m_bFastForward) {
+				m_FrameCount += Tick_FastForward();
+			} else {
+				while (IsPlaying()) {
+					Tick_Headless();
+					m_FrameCount++;
+				}
+			}
+
+			// end game
+			EndGame();
+		}
+
+	} // end of TCGAMECONTROL::Run_Headless
+
+	/*!
+		画面出力せずに、ラウンドとプレイヤの組み合わせごとのゲームをスレッドプールで並列に実行します。
+		タスクごとにプレイヤのインスタンスを生成するので、プレイヤは１ラウンドごとに新しいインスタンスになり、
+		同じインスタンス ID のインスタンスが、別のラウンドで同時に存在することがあります。
+		DLL はメインスレッドで一度ずつ開いて実行中はロードしたままにするので、DLL 内のテーブルもメインスレッドで構築されます。
+		各ラウンドのピース列はメインスレッドで決まった順に生成しておき、すべてのタスクを一度にスレッドプールに渡します。
+		結果は、先頭から順にラウンドのタスクがすべて終わるたびに、ラウンド順（同じラウンド内はプレイヤの登録順）に出力します。
+	*/
+	void	Run_Parallel()
+	{
+		// ワーカスレッドから使うテーブルを、先にメインスレッドで構築しておく
+		TCPIECE::Prepare();
+		OpenPlayer();
+
+		// start game
+		std::string						Rule = m_RuleList.GetString();
+		std::vector<TCPIECESEQUENCE>	Sequences;
+		for (size_t round = 1; round <= m_RoundCount; round++) {
+			Sequences.push_back(MakeSequence(round));
+		}
+
+		std::vector<TCTHREADPOOL::TASK*>	Tasks;
+		for (size_t round = 1; round <= m_RoundCount; round++) {
+			for (size_t ii = 0; ii < m_PlayerLibs.size(); ii++) {
+				TCPLAYFIELD	*pPlayField = new TCPLAYFIELD(
+					static_cast<int8_t>(m_RuleList.GetInteger("W")),
+					static_cast<int8_t>(m_RuleList.GetInteger("H")),
+					static_cast<int8_t>(m_RuleList.GetInteger("G"))
+				);
+				Tasks.push_back(new ROUNDTASK(pPlayField, m_PlayerLibs[ii], GetInstanceId(ii), &Rule, &Sequences[round - 1], round, m_bFastForward));
+			}
+		}
+
+		// exec（結果は OnDone で出力する）
+		m_pRoundTasks = &Tasks;
+		m_RoundDone.assign(m_RoundCount, 0);
+		m_Round = 1;
+		{
+			TCTHREADPOOL	Pool(m_ThreadCount);
+			Pool.Run(Tasks, this);
+		}
+		m_pRoundTasks = NULL;
+
+		for (size_t ii = 0; ii < Tasks.size(); ii++) {
+			delete Tasks[ii];
+			Tasks[ii] = NULL;
+		}
+
+	} // end of TCGAMECONTROL::Run_Parallel
+
+	/*!
+		並列実行モードでタスクが終わるたびに、先頭から順に、全プレイヤが終わったラウンドの結果を出力します。
+		スレッドプールが呼び出しを直列化するので、ロックは不要です。
+		@param[in/out] pTask 終わったタスク
+	*/
+	void	OnDone(TCTHREADPOOL::TASK *pTask)
+	{
+		ROUNDTASK	*pDone = static_cast<ROUNDTASK*>(pTask);
+		m_RoundDone[pDone->m_Round - 1]++;
+
+		size_t	PlayerCount = m_PlayerLibs.size();
+		while ((m_Round <= m_RoundCount) && (m_RoundDone[m_Round - 1] == PlayerCount)) {
+			// end game
+			std::vector<ENTRY>	Entries;
+			size_t				FrameCount = 0;
+			for (size_t ii = 0; ii < PlayerCount; ii++) {
+				ROUNDTASK	*pRoundTask = static_cast<ROUNDTASK*>((*m_pRoundTasks)[(m_Round - 1) * PlayerCount + ii]);
+				Entries.push_back(ENTRY(pRoundTask->m_pPlayField, m_Container.GetPlayerDll(ii)));	// プレイヤ名は、メインスレッドで開いたインスタンスから取得する
+				FrameCount = max(FrameCount, pRoundTask->m_FrameCount);
+			}
+			m_FrameCount += FrameCount;	// 逐次実行と同じく、全プレイヤが終わるまでのフレーム数
+			EndGame(Entries.begin(), Entries.end());
+			m_Round++;
+		}
+
+	} // end of TCGAMECONTROL::OnDone
+
 	virtual TCVIEW	*CreateViewer(int8_t PosX, int8_t PosY, int8_t PosZ)
 	{
+		if (m_bHeadless) {
+			// 何も出力しない
+			return new TCVIEW_NULL(PosX, PosY, PosZ);
+		}
+
 		// 状況をコンソール画面に出力する
 		return new TCVIEW_CONSOLE(PosX, PosY, PosZ);
 
@@ -570,38 +1005,88 @@ private:
 
 	void	OpenPlayer()
 	{
-		for (GAMECONTENT::const_iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
-			bool rv = it->second->Open(m_RuleList.GetString().c_str());
+		for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+			bool rv = m_Container.GetPlayerDll(idx)->Open(m_RuleList.GetString().c_str());
 			TCASSERT(rv, "open failed.");
 		}
 
 	} // end of TCGAMECONTROL::OpenPlayer
 
-	EVENTQUEUE	StartGame()
+	void	StartGame()
 	{
-		TCRANDOMGENERATOR	randgen(0);
-		EVENTQUEUE	queue;
-		for (GAMECONTENT::const_iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
-			TCEVENT	evt = it->first->StartGame(randgen, it->second->Get());
+		m_Sequence = MakeSequence(m_Round);
+		for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+			TCEVENT	evt = m_Container.GetPlayField(idx).StartGame(m_Sequence, m_Container.GetPlayerDll(idx)->Get());
+			m_Container.Update(idx);
 			if (evt != 0) {
-				queue.insert(queue.end(), EVENTX(it->first, evt));
+				m_Queue.Push(idx, evt);
 			}
 		}
-		return queue;
 
 	} // end of TCGAMECONTROL::StartGame
 
+	/*!
+		次のラウンドのピース列を生成します。ラウンド順に呼ばなければなりません。
+		コーパスを開いていれば、ラウンド N にはコーパスの N 番目（1～）のピース列を使います。
+		そうでなければ、ラウンドごとのシードを RuleOpt の SEED から順に生成するので、SEED を指定すれば、
+		逐次実行・並列実行のどちらでも、何度実行しても、同じラウンドには同じピース列が使われます。
+		@param[in] Round ラウンド数（1～）
+		@return ピース列
+	*/
+	TCPIECESEQUENCE	MakeSequence(size_t Round)
+	{
+		if (m_Corpus.IsOpen()) {
+			return m_Corpus.GetSequence(Round - 1);
+		}
+
+		return MakeSeededSequence(m_Seeder);
+
+	} // end of TCGAMECONTROL::MakeSequence
+
+public:
+	/*!
+		ラウンドごとのシードを生成する乱数ジェネレータから、次のラウンドのピース列を生成します。
+		RuleOpt の SEED で初期化した乱数ジェネレータで N 回目に生成したものが、ラウンド N のピース列になります。
+		@param[in/out] Seeder ラウンドごとのシードを生成する乱数ジェネレータ
+		@return ピース列
+	*/
+	static TCPIECESEQUENCE	MakeSeededSequence(TCRANDOMGENERATOR &Seeder)
+	{
+		uint32_t	Seed = Seeder.Get();
+		TCRANDOMGENERATOR	Random((Seed != 0) ? Seed : 1);	// 0 は秒カウンタの代用になってしまう
+		return TCPIECESEQUENCE(Random, TCPIECESEQUENCE::GetRoundCount());
+
+	} // end of TCGAMECONTROL::MakeSeededSequence
+
+private:
 	void	EndGame()
+	{
+		std::vector<ENTRY>	Entries;
+		for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+			Entries.push_back(ENTRY(&m_Container.GetPlayField(idx), m_Container.GetPlayerDll(idx)));
+		}
+		EndGame(Entries.begin(), Entries.end());
+
+	} // end of TCGAMECONTROL::EndGame
+
+	/*!
+		ラウンドの結果を出力します。
+		@param[in] first プレイフィールドとプレイヤの組の先頭
+		@param[in] last プレイフィールドとプレイヤの組の終端
+	*/
+	template <typename ITER>
+	void	EndGame(ITER first, ITER last)
 	{
 		// setup result content
 		std::strstream	rv;
 		rv << GetString();
-		for (GAMECONTENT::const_iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
+		for (ITER it = first; it != last; ++it) {
 			rv
 				<< ","
 				<< it->second->Get()->GetString()
 				<< "&"
 				<< it->first->GetScore().GetString();
+			m_PieceCount += static_cast<size_t>(it->first->GetScore().GetPieces());
 		}
 		rv << std::ends;
 
@@ -611,28 +1096,96 @@ private:
 
 	bool	IsPlaying() const
 	{
-		bool	bPlaying = false;
-		for (GAMECONTENT::const_iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
-			bPlaying = bPlaying || it->first->IsPlaying();
-		}
-		return bPlaying;
+		return m_Container.IsPlaying();
 
 	} // end of TCGAMECONTROL::IsPlaying
 
-	EVENTQUEUE	Tick()
+	void	Tick()
 	{
-		EVENTQUEUE	queue;
-		for (GAMECONTENT::const_iterator it = m_Container.begin(); it != m_Container.end(); ++it) {
-			TCEVENT	evt = it->first->Tick(it->second->Get());
+		// プレイ中でないプレイフィールドは、進行させても何も起こらない
+		for (size_t idx = m_Container.FindPlaying(0); idx < m_Container.GetCount(); idx = m_Container.FindPlaying(idx + 1)) {
+			TCEVENT	evt = m_Container.GetPlayField(idx).Tick(m_Container.GetPlayerDll(idx)->Get());
+			m_Container.Update(idx);
 			if (evt != 0) {
-				queue.insert(queue.end(), EVENTX(it->first, evt));
+				m_Queue.Push(idx, evt);
 			}
 		}
-		return queue;
 
 	} // end of TCGAMECONTROL::Tick
 
-private:
+	void	Tick_Headless()
+	{
+		for (size_t idx = m_Container.FindPlaying(0); idx < m_Container.GetCount(); idx = m_Container.FindPlaying(idx + 1)) {
+			m_Container.GetPlayField(idx).Tick(m_Container.GetPlayerDll(idx)->Get());
+			m_Container.Update(idx);
+		}
+
+	} // end of TCGAMECONTROL::Tick_Headless
+
+	/*!
+		すべてのプレイフィールドを、変化のないフレームを早送りしながら、プレイ終了まで進行させます。
+		@return 全プレイフィールドが終わるまでのフレーム数
+	*/
+	size_t	Tick_FastForward()
+	{
+		size_t	FrameCount = 0;
+		for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+			TCPLAYFIELD	&PlayField = m_Container.GetPlayField(idx);
+			size_t		PlayFrames = 0;
+			while (PlayField.IsPlaying()) {
+				size_t	Frames = 0;
+				PlayField.Tick(m_Container.GetPlayerDll(idx)->Get(), FAST_FORWARD_FRAME, Frames);
+				PlayFrames += Frames;
+			}
+			m_Container.Update(idx);
+			FrameCount = max(FrameCount, PlayFrames);
+		}
+		return FrameCount;
+
+	} // end of TCGAMECONTROL::Tick_FastForward
+
+	/*!
+		すべてのプレイフィールドを、バッチで１フレームずつ揃えて、プレイ終了まで進行させます。
+		@param[in/out] Batch 全プレイフィールドを登録したバッチ
+		@return 全プレイフィールドが終わるまでのフレーム数
+	*/
+	size_t	Tick_Batch(TCPLAYFIELDBATCH &Batch)
+	{
+		size_t	FrameCount = 0;
+		Batch.Reset();
+		while (Batch.IsPlaying()) {
+			Batch.Tick();
+			FrameCount++;
+		}
+		Batch.Flush();
+
+		for (size_t idx = 0; idx < m_Container.GetCount(); idx++) {
+			m_Container.Update(idx);
+		}
+		return FrameCount;
+
+	} // end of TCGAMECONTROL::Tick_Batch
+
+	/*!
+		登録されたプレイヤに割り当てるインスタンス ID を返します。
+		同じ DLL を複数登録したときに区別できるよう、それより前に登録された同じ DLL の数とします。
+		並列実行モードでタスクごとにインスタンスを生成しても、同じプレイヤには同じ ID が割り当てられます。
+		@param[in] PlayerIdx プレイヤの登録順（0～）
+		@return インスタンス ID
+	*/
+	size_t	GetInstanceId(size_t PlayerIdx) const
+	{
+		size_t	InstanceId = 0;
+		for (size_t ii = 0; ii < PlayerIdx; ii++) {
+			if (m_PlayerLibs[ii] == m_PlayerLibs[PlayerIdx]) {
+				InstanceId++;
+			}
+		}
+		return InstanceId;
+
+	} // end of TCGAMECONTROL::GetInstanceId
+
+public:
 	/*!
 		実行中のホスト名を取得します。
 		@param[in] bInit ソケットレイヤの初期化（WSAStartup）を実施するかどうか
@@ -0,0 +1,165 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCHASH_H
+#define TCHASH_H
+//! @file
+
+#include "tctype.h"
+#include "tcbit.h"
+
+//----------------------------------------------------------------------------
+/*!
+	盤面の状態を 64bit のハッシュ値（Zobrist ハッシュ）で表すための関数群です。
+	フィールドのマスごとに固定の乱数（キー）を割り当て、埋まっているマスのキーの XOR をフィールドのハッシュ値とします。
+	マスが埋まるたびに、そのマスのキーを XOR するだけでハッシュ値を更新できます。
+	キーは固定のシードから生成するため、実行ファイル・プレイヤ DLL のどちらで求めても同じ値になります。
+*/
+class TCHASH
+{
+	//
+	// assign
+	//
+public:
+	static const int8_t		CELL_X_MAX = 64;	//!< キーを割り当てる X 位置の数（１段が 64bit のフィールドまで）
+	static const int8_t		CELL_Y_MAX = 32;	//!< キーを割り当てる Y 位置の数（枠を含めた高さ 32 まで）
+
+private:
+	/*!
+		マスごとのキーを保持しておくためのテーブルです。
+	*/
+	class KEYTABLE
+	{
+		//
+		// variable
+		//
+	private:
+		uint64_t		m_Key[CELL_Y_MAX][CELL_X_MAX];	//!< マスごとのキー
+
+		//
+		// method
+		//
+	public:
+		KEYTABLE()
+		{
+			uint64_t	Seed = 0;
+			for (int8_t yy = 0; yy < CELL_Y_MAX; yy++) {
+				for (int8_t xx = 0; xx < CELL_X_MAX; xx++) {
+					Seed += GOLDEN;
+					m_Key[yy][xx] = Mix(Seed);
+				}
+			}
+
+		} // end of TCHASH::KEYTABLE::ctor
+
+		uint64_t	Get(int8_t PosX, int8_t PosY) const
+		{
+			return m_Key[PosY][PosX];
+
+		} // end of TCHASH::KEYTABLE::Get
+	};
+
+	static const uint64_t	GOLDEN = 0x9E3779B97F4A7C15ULL;	//!< 黄金比から作った定数（SplitMix64 の増分）
+
+	//
+	// method
+	//
+public:
+	/*!
+		指定されたマスのキーを返します。
+		@param[in] PosX 横位置（X 値、0～CELL_X_MAX-1）
+		@param[in] PosY 縦位置（Y 値、0～CELL_Y_MAX-1）
+		@return キー（範囲外のときは 0）
+	*/
+	static uint64_t	GetCellKey(int8_t PosX, int8_t PosY)
+	{
+		if (
+			(PosX < 0) || (PosX >= CELL_X_MAX) ||
+			(PosY < 0) || (PosY >= CELL_Y_MAX)
+		) {
+			return 0;
+		}
+		return GetKeyTable().Get(PosX, PosY);
+
+	} // end of TCHASH::GetCellKey
+
+	/*!
+		１段のうち、指定されたマスのキーの XOR を返します。
+		@param[in] PosY 縦位置（Y 値、0～CELL_Y_MAX-1）
+		@param[in] Cells マスのビットマップ（bitN が X=N のマス）
+		@return キーの XOR
+	*/
+	template <typename ROW>
+	static uint64_t	GetRowKey(int8_t PosY, ROW Cells)
+	{
+		uint64_t	Value = 0;
+		for (; Cells; Cells &= Cells - 1) {
+			Value ^= GetCellKey(static_cast<int8_t>(TCBIT::TRAITS<ROW>::FindLowest(Cells)), PosY);
+		}
+		return Value;
+
+	} // end of TCHASH::GetRowKey
+
+	/*!
+		64bit の値をかき混ぜます（SplitMix64 の出力関数）。
+		ピースの状態や乱数ジェネレータの状態など、マス以外の値をハッシュ値にするときに使用します。
+		@param[in] Value かき混ぜる値
+		@return かき混ぜた値
+	*/
+	static uint64_t	Mix(uint64_t Value)
+	{
+		Value = (Value ^ (Value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		Value = (Value ^ (Value >> 27)) * 0x94D049BB133111EBULL;
+		return Value ^ (Value >> 31);
+
+	} // end of TCHASH::Mix
+
+	/*!
+		２つのハッシュ値を、順序を区別して１つにまとめます。
+		@param[in] Seed まとめる先のハッシュ値
+		@param[in] Value まとめるハッシュ値
+		@return まとめたハッシュ値
+	*/
+	static uint64_t	Combine(uint64_t Seed, uint64_t Value)
+	{
+		// Seed だけを先にかき混ぜるので、Combine(a, b) と Combine(b, a) は一致しない
+		return Mix(Mix(Seed + GOLDEN) ^ Value);
+
+	} // end of TCHASH::Combine
+
+private:
+	static const KEYTABLE	&GetKeyTable()
+	{
+		static const KEYTABLE	KeyTable;
+		return KeyTable;
+
+	} // end of TCHASH::GetKeyTable
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCHASH_H
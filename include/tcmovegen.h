@@ -0,0 +1,314 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCMOVEGEN_H
+#define TCMOVEGEN_H
+//! @file
+
+#include <cstring>
+#include <vector>
+#include "tctype.h"
+#include "tcbit.h"
+#include "tcfield.h"
+#include "tcpiece.h"
+#include "tcpos.h"
+
+//----------------------------------------------------------------------------
+/*!
+	落下中のピースを操作して固めることができる位置（配置）を、すべて列挙するためのクラスです。
+	TCPLAYFIELD と同じ操作規則で、到達できる（回転状態, X 位置, Y 位置）をビットボード上で塗りつぶして求めます。
+	- 回転は、その場で回転した位置に配置できるときだけ成功する（壁蹴りはない）
+	- 移動は、左右に１列ずつ
+	- 落下は、下に１段ずつ（上には戻れない）
+	- 下の段に配置できない位置で固まる
+	真上から落とすだけの配置に加えて、落下後に横に滑り込ませる配置（転がし）や、
+	回転してはまり込ませる配置（回転入れ）も列挙します。
+	重力によってフレームごとに落下することによる時間の制約は考慮しません（移動・回転は何回でもできるものとして扱います）。
+	回転状態は違っても形状が同じ（I・O・S・Z）配置は、最も小さい回転状態の配置にまとめます。
+	ROW_T はフィールドの１段を表す整数型で、扱うフィールドの TCFIELDT に合わせます。
+	段ごとの状態はインスタンス内に固定長で保持しているため、Generate を繰り返し呼び出してもヒープの確保は発生しません（列挙結果の配列を除く）。
+*/
+template <typename ROW_T>
+class TCMOVEGENT
+{
+	//
+	// assign
+	//
+public:
+	typedef ROW_T					ROW;	//!< フィールドの１段を表す整数型
+	typedef TCFIELDT<ROW>			FIELD;	//!< 対象とするフィールド
+	typedef TCBIT::TRAITS<ROW>		BIT;	//!< ROW に対するビット演算
+
+private:
+	static const int8_t	ROW_GUARD = TCPIECE::PIECE_WIDTH - 1;	//!< 床より下に、ピースの Y 位置が取りうる段の数
+	static const size_t	ROW_COUNT = ROW_GUARD + FIELD::FIELD_HEIGHT_MAX + 2 + 1;	//!< 段ごとの状態の数（天井のさらに１つ上の段まで）
+	static const size_t	PLACEMENT_RESERVE = 256;	//!< 列挙結果の配列にあらかじめ確保しておく要素数
+
+	//
+	// variable
+	//
+private:
+	uint8_t				m_Fig;									//!< 最後に列挙したピースの形状
+	int8_t				m_OfsX[TCPIECE::ROT_MAX];				//!< 回転状態ごとの、ピースの X 位置から最も右の列までの距離
+	ROW					m_Free[TCPIECE::ROT_MAX][ROW_COUNT];	//!< 回転状態・段ごとの、ピースを配置できる位置（bitN が、ピースの最も右の列を X=N に置いた場合）
+	ROW					m_Reach[TCPIECE::ROT_MAX][ROW_COUNT];	//!< 回転状態・段ごとの、到達できる位置（並びは m_Free と同じ）
+	std::vector<TCPIECE>	m_Placements;						//!< 列挙した配置
+
+	//
+	// method
+	//
+public:
+	/*!
+		標準のコンストラクタです。
+	*/
+	TCMOVEGENT()
+		: m_Fig(TCPIECE::FIG_VOID)
+	{
+		memset(m_OfsX, 0, sizeof(m_OfsX));
+		memset(m_Free, 0, sizeof(m_Free));
+		memset(m_Reach, 0, sizeof(m_Reach));
+		m_Placements.reserve(PLACEMENT_RESERVE);
+
+	} // end of TCMOVEGEN::ctor
+
+	/*!
+		指定されたピースを操作して固めることができる位置を、すべて列挙します。
+		列挙した配置は GetPlacements で取得できます。
+		@param[in] Field フィールド
+		@param[in] Piece 操作を開始するピース
+		@param[in] bPrep true なら、Piece を TCEVENT_PREP で渡された落下前のピースとして扱う（落下開始前の回転を含めて列挙する）
+		@return 列挙した配置の数
+	*/
+	size_t	Generate(const FIELD &Field, const TCPIECE &Piece, bool bPrep)
+	{
+		m_Placements.clear();
+		memset(m_Reach, 0, sizeof(m_Reach));
+
+		// 回転状態ごとのマスの位置と、形状が同じ回転状態のまとめ先
+		m_Fig = Piece.m_Fig;
+		int8_t	CellX[TCPIECE::ROT_MAX][TCPIECE::PIECE_WIDTH];
+		int8_t	CellY[TCPIECE::ROT_MAX][TCPIECE::PIECE_WIDTH];
+		uint8_t	Canon[TCPIECE::ROT_MAX];
+		for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+			m_OfsX[Rot] = TCPIECE::GetCells(m_Fig, Rot, CellX[Rot], CellY[Rot]);
+			if (m_OfsX[Rot] < 0) {
+				return 0;
+			}
+			Canon[Rot] = Rot;
+			for (uint8_t Rot2 = 0; Rot2 < Rot; Rot2++) {
+				if (
+					(m_OfsX[Rot2] == m_OfsX[Rot]) &&
+					(memcmp(CellX[Rot2], CellX[Rot], sizeof(CellX[Rot])) == 0) &&
+					(memcmp(CellY[Rot2], CellY[Rot], sizeof(CellY[Rot])) == 0)
+				) {
+					Canon[Rot] = Canon[Rot2];
+					break;
+				}
+			}
+		}
+
+		// 回転状態・段ごとに、ピースを配置できる位置をまとめて求める
+		int8_t	TopY = Field.GetSize().GetY() - 1;
+		for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+			for (int8_t yy = -ROW_GUARD; yy <= TopY; yy++) {
+				m_Free[Rot][ROW_GUARD + yy] = static_cast<ROW>(Field.GetLineFilled() & ~Field.GetHitMap(yy, CellX[Rot], CellY[Rot]));
+			}
+			m_Free[Rot][ROW_GUARD + TopY + 1] = 0;
+		}
+
+		// 操作を開始する位置
+		int8_t	StartY = -ROW_GUARD - 1;
+		int8_t	StartMinY = TopY + 1;
+		if (bPrep) {
+			static const int8_t	PrepRot[] = { 0, +1, -1, };	// 落下開始前に１回だけ回転できる
+			for (size_t ii = 0; ii < sizeof(PrepRot) / sizeof(PrepRot[0]); ii++) {
+				TCPIECE	Start = Piece.Rotate(PrepRot[ii]);
+				Start = Start.MoveY(Start.GetTopOfsY());
+				AddStart(Start, TopY, StartY, StartMinY);
+			}
+		} else {
+			AddStart(Piece, TopY, StartY, StartMinY);
+		}
+
+		// 上の段から順に、落下・移動・回転で到達できる位置を塗りつぶす
+		for (int8_t yy = StartY; yy >= -ROW_GUARD; yy--) {
+			size_t	idx = ROW_GUARD + yy;
+			ROW		Any = 0;
+			for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+				m_Reach[Rot][idx] = static_cast<ROW>((m_Reach[Rot][idx] | m_Reach[Rot][idx + 1]) & m_Free[Rot][idx]);
+				Any |= m_Reach[Rot][idx];
+			}
+			if ((Any == 0) && (yy <= StartMinY)) {
+				// これより下の段には到達できない
+				break;
+			}
+
+			for (bool bChanged = true; bChanged; ) {
+				bChanged = false;
+				for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+					ROW		Reach = Fill(m_Reach[Rot][idx], m_Free[Rot][idx]);
+					m_Reach[Rot][idx] = Reach;
+
+					// 左回転・右回転
+					for (uint8_t RotOfs = 1; RotOfs < TCPIECE::ROT_MAX; RotOfs += 2) {
+						uint8_t	Rot2 = (Rot + RotOfs) % TCPIECE::ROT_MAX;
+						int8_t	Shift = m_OfsX[Rot2] - m_OfsX[Rot];
+						ROW		Rotated = static_cast<ROW>(((Shift >= 0) ? (Reach << Shift) : (Reach >> -Shift)) & m_Free[Rot2][idx]);
+						if (Rotated & ~m_Reach[Rot2][idx]) {
+							m_Reach[Rot2][idx] |= Rotated;
+							bChanged = true;
+						}
+					}
+				}
+			}
+		}
+
+		// 下の段に配置できない位置が、固めることができる位置
+		for (uint8_t Rot = 0; Rot < TCPIECE::ROT_MAX; Rot++) {
+			if (Canon[Rot] != Rot) {
+				continue;
+			}
+			for (int8_t yy = -ROW_GUARD; yy <= TopY; yy++) {
+				size_t	idx = ROW_GUARD + yy;
+				ROW		Lock = 0;
+				for (uint8_t Rot2 = Rot; Rot2 < TCPIECE::ROT_MAX; Rot2++) {
+					if (Canon[Rot2] == Rot) {
+						Lock |= (idx > 0) ? (m_Reach[Rot2][idx] & ~m_Free[Rot2][idx - 1]) : m_Reach[Rot2][idx];
+					}
+				}
+				for (; Lock; Lock &= Lock - 1) {
+					int8_t	PosX = static_cast<int8_t>(BIT::FindLowest(Lock) - m_OfsX[Rot]);
+					m_Placements.push_back(TCPIECE(m_Fig, Rot, TCPOS(PosX, yy)));
+				}
+			}
+		}
+		return m_Placements.size();
+
+	} // end of TCMOVEGEN::Generate
+
+	/*!
+		最後に Generate で列挙した配置を返します。
+		並びは、回転状態の昇順、その中では Y 位置の昇順、その中では X 位置の昇順です。
+		@return 列挙した配置
+	*/
+	const std::vector<TCPIECE>	&GetPlacements() const
+	{
+		return m_Placements;
+
+	} // end of TCMOVEGEN::GetPlacements
+
+	/*!
+		最後に Generate を呼び出したときに、指定された位置（回転状態, X 位置, Y 位置）に到達できたかどうかを返します。
+		固めることができる位置に限らず、途中で通過できる位置も含みます。
+		@param[in] Piece 調べるピース（形状は Generate に渡したものと同じでなければならない）
+		@retval true 到達できる
+		@retval false 到達できない
+	*/
+	bool	IsReachable(const TCPIECE &Piece) const
+	{
+		int8_t	PosY = Piece.m_Pos.GetY();
+		int8_t	Anchor = Piece.m_Pos.GetX() + m_OfsX[Piece.m_Rot % TCPIECE::ROT_MAX];
+		if (
+			(Piece.m_Fig != m_Fig) ||
+			(PosY < -ROW_GUARD) ||
+			(PosY + ROW_GUARD >= static_cast<ssize_t>(ROW_COUNT)) ||
+			(Anchor < 0)
+		) {
+			return false;
+		}
+		return (m_Reach[Piece.m_Rot % TCPIECE::ROT_MAX][ROW_GUARD + PosY] & BIT::Get(Anchor)) != 0;
+
+	} // end of TCMOVEGEN::IsReachable
+
+private:
+	/*!
+		操作を開始する位置を追加します。
+		@param[in] Piece 操作を開始するピース
+		@param[in] TopY ピースの Y 位置の上限
+		@param[in/out] StartY 操作を開始する位置の、最も上の Y 位置
+		@param[in/out] StartMinY 操作を開始する位置の、最も下の Y 位置
+	*/
+	void	AddStart(const TCPIECE &Piece, int8_t TopY, int8_t &StartY, int8_t &StartMinY)
+	{
+		int8_t	PosY = Piece.m_Pos.GetY();
+		int8_t	Anchor = Piece.m_Pos.GetX() + m_OfsX[Piece.m_Rot];
+		if (
+			(PosY < -ROW_GUARD) ||
+			(PosY > TopY) ||
+			(Anchor < 0)
+		) {
+			return;
+		}
+
+		size_t	idx = ROW_GUARD + PosY;
+		ROW		Start = static_cast<ROW>(BIT::Get(Anchor) & m_Free[Piece.m_Rot][idx]);
+		if (Start == 0) {
+			// 配置できない位置からは操作できない
+			return;
+		}
+
+		m_Reach[Piece.m_Rot][idx] |= Start;
+		if (StartY < PosY) {
+			StartY = PosY;
+		}
+		if (StartMinY > PosY) {
+			StartMinY = PosY;
+		}
+
+	} // end of TCMOVEGEN::AddStart
+
+	/*!
+		１段の中で、左右の移動で到達できる位置を塗りつぶします。
+		Free の連続した 1 のうち、Seed を含むものをすべて 1 にします（シフト量を倍々にして、log2(ビット幅) 回で済ませる）。
+		@param[in] Seed 塗りつぶしを開始する位置
+		@param[in] Free 配置できる位置
+		@return 到達できる位置
+	*/
+	static ROW	Fill(ROW Seed, ROW Free)
+	{
+		ROW		ValueL = static_cast<ROW>(Seed & Free);
+		ROW		ValueR = ValueL;
+		ROW		FreeL = Free;
+		ROW		FreeR = Free;
+		for (size_t ss = 1; ss < BIT::BITS; ss <<= 1) {
+			ValueL |= static_cast<ROW>(FreeL & (ValueL << ss));
+			FreeL &= static_cast<ROW>(FreeL << ss);
+			ValueR |= static_cast<ROW>(FreeR & (ValueR >> ss));
+			FreeR &= static_cast<ROW>(FreeR >> ss);
+		}
+		return static_cast<ROW>(ValueL | ValueR);
+
+	} // end of TCMOVEGEN::Fill
+};
+
+typedef TCMOVEGENT<uint16_t>	TCMOVEGEN16;	//!< TCFIELD16 用
+typedef TCMOVEGENT<uint32_t>	TCMOVEGEN;		//!< TCFIELD 用
+typedef TCMOVEGENT<uint64_t>	TCMOVEGEN64;	//!< TCFIELD64 用
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCMOVEGEN_H
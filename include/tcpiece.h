@@ -28,8 +28,11 @@
 #define TCPIECE_H
 //! @file
 
+#include <cstring>
 #include <vector>
 #include "tctype.h"
+#include "tcbit.h"
+#include "tchash.h"
 #include "tcpos.h"
 #include "tcrandomgenerator.h"
 #include "tcsize.h"
@@ -60,6 +63,8 @@ class TCPIECE
 	//
 public:
 	static const int8_t		PIECE_WIDTH	= 4;
+	static const int8_t		MASK_POS_X_MIN = -(PIECE_WIDTH - 1);	//!< シフト済みビットマップを保持する X 位置の下限
+	static const int8_t		MASK_POS_X_MAX = 32 - 1;				//!< シフト済みビットマップを保持する X 位置の上限（フィールドの１段が 32bit のとき。一般には TCBIT::TRAITS<ROW>::BITS - 1）
 
 	enum ROT
 	{
@@ -78,11 +83,70 @@ public:
 		FIG_VOID	= 7,
 	};
 
+private:
+	/*!
+		ピースのビットマップ形状を、あらかじめ X 位置ごとにシフトして保持しておくためのテーブルです。
+		フィールドとの当たり判定のたびにビットマップを生成・シフトせずに済むようにします。
+		ROW はフィールドの１段を表す整数型です。
+	*/
+	template <typename ROW>
+	class MASKTABLE
+	{
+		//
+		// assign
+		//
+	public:
+		static const int8_t	POS_X_MAX = TCBIT::TRAITS<ROW>::BITS - 1;	//!< シフト済みビットマップを保持する X 位置の上限
+		static const size_t	PACKED_COUNT = sizeof(ROW) * PIECE_WIDTH / sizeof(uint64_t);	//!< ４段分を詰めた 64bit 整数の数
+
+	private:
+		static const size_t	POS_X_COUNT = POS_X_MAX - MASK_POS_X_MIN + 1;
+
+		//
+		// variable
+		//
+	private:
+		ROW				m_Mask[FIG_MAX][ROT_MAX][POS_X_COUNT][PIECE_WIDTH];	//!< シフト済みのビットマップ形状
+		uint64_t		m_Packed[FIG_MAX][ROT_MAX][POS_X_COUNT][PACKED_COUNT];	//!< シフト済みのビットマップ形状を４段まとめて 64bit 整数に詰めたもの
+
+		//
+		// method
+		//
+	public:
+		MASKTABLE()
+		{
+			for (uint8_t Fig = 0; Fig < FIG_MAX; Fig++) {
+				for (uint8_t Rot = 0; Rot < ROT_MAX; Rot++) {
+					const uint32_t	*pBitmap = GetBitmapTable(Fig, Rot);
+					for (size_t ii = 0; ii < POS_X_COUNT; ii++) {
+						ssize_t	PosX = MASK_POS_X_MIN + static_cast<ssize_t>(ii);
+						for (int8_t yy = 0; yy < PIECE_WIDTH; yy++) {
+							m_Mask[Fig][Rot][ii][yy] = static_cast<ROW>((PosX >= 0) ? (static_cast<ROW>(pBitmap[yy]) << PosX) : (pBitmap[yy] >> -PosX));
+						}
+						// フィールドの連続する４段を memcpy で読み出したものと同じ並びにする
+						memcpy(m_Packed[Fig][Rot][ii], m_Mask[Fig][Rot][ii], sizeof(m_Packed[Fig][Rot][ii]));
+					}
+				}
+			}
+
+		} // end of TCPIECE::MASKTABLE::ctor
+
+		const ROW		*Get(uint8_t Fig, uint8_t Rot, int8_t PosX) const
+		{
+			return m_Mask[Fig][Rot][PosX - MASK_POS_X_MIN];
+
+		} // end of TCPIECE::MASKTABLE::Get
+
+		const uint64_t	*GetPacked(uint8_t Fig, uint8_t Rot, int8_t PosX) const
+		{
+			return m_Packed[Fig][Rot][PosX - MASK_POS_X_MIN];
+
+		} // end of TCPIECE::MASKTABLE::GetPacked
+	};
+
 	//
 	// variable
 	//
-private:
-	static TCSIZE	m_FieldSize;	//!< フィールドサイズ
 public:
 	uint8_t			m_Fig;			//!< ピースの形状（TCPIECE::FIG）
 	uint8_t			m_Rot;			//!< ピースの回転状態（0:回転なし、1:左１回、2:左２回、3:左３回）
@@ -92,18 +156,6 @@ public:
 	// method
 	//
 public:
-	/*!
-		フィールドのサイズをクラスフィールドに設定します。
-		ピースの出現位置を決定するために必要です。
-		ゲームプレイを開始する前に設定しなければなりません。
-		@param[in] FieldSize フィールドのサイズ
-	*/
-	static void	SetField(const TCSIZE &FieldSize)
-	{
-		m_FieldSize = FieldSize;
-
-	} // end of TCPIECE::SetFieldSize
-
 	/*!
 		デフォルトのコンストラクタです。
 		形状は未知、回転状態はゼロ、位置はゼロに初期化されます。
@@ -161,29 +213,46 @@ public:
 		ピースの形状を乱数による変更し、
 		ピースの回転状態をゼロに変更し、
 		ピースの位置をフィールド所定の落下前位置に変更します。
+		落下前位置はフィールドのサイズから決まるので、ピースを出現させるフィールドのサイズを渡します。
 		@param[in/out] Random 乱数インスタンス
+		@param[in] FieldSize フィールドのサイズ（枠を含む）
+	*/
+	void	Randomize(TCRANDOMGENERATOR &Random, const TCSIZE &FieldSize)
+	{
+		Spawn(static_cast<uint8_t>(Random.Get() % FIG_MAX), FieldSize);
+
+	} // end of TCPIECE::Randomize
+
+	/*!
+		ピースの形状を指定されたものに変更し、
+		ピースの回転状態をゼロに変更し、
+		ピースの位置をフィールド所定の落下前位置に変更します。
+		あらかじめ生成しておいたピース列（TCPIECESEQUENCE）からピースを出現させるときに利用されます。
+		@param[in] Fig ピースの形状
+		@param[in] FieldSize フィールドのサイズ（枠を含む）
 	*/
-	void	Randomize(TCRANDOMGENERATOR &Random)
+	void	Spawn(uint8_t Fig, const TCSIZE &FieldSize)
 	{
-		m_Fig = static_cast<uint8_t>(Random.Get() % FIG_MAX);
+		m_Fig = Fig;
 		m_Rot = 0;
-		m_Pos = TCPOS((m_FieldSize.GetX() - PIECE_WIDTH) / 2, m_FieldSize.GetY() - 1);
+		m_Pos = TCPOS((FieldSize.GetX() - PIECE_WIDTH) / 2, FieldSize.GetY() - 1);
 		if (m_Fig == FIG_I) {
 			m_Pos += TCPOS(0, -1);
 		}
 
-	} // end of TCPIECE::Randomize
+	} // end of TCPIECE::Spawn
 
 	/*!
 		ピースを無効にします。
 		落下中のピースがフィールドに着地したときに利用されます。
 		ピースが無効かどうかは、m_Fig が FIG_VOID かどうかを確認することで判断できます。
+		@param[in] FieldSize フィールドのサイズ（枠を含む。位置をフィールド所定の落下前位置にするため）
 	*/
-	void	Invalidate()
+	void	Invalidate(const TCSIZE &FieldSize)
 	{
 		m_Fig = FIG_VOID;
 		m_Rot = 0;
-		m_Pos = TCPOS((m_FieldSize.GetX() - PIECE_WIDTH) / 2, m_FieldSize.GetY() - 1);
+		m_Pos = TCPOS((FieldSize.GetX() - PIECE_WIDTH) / 2, FieldSize.GetY() - 1);
 
 	} // end of TCPIECE::Invalidate
 
@@ -491,6 +560,188 @@ public:
 		@retval ビットマップ形状
 	*/
 	static std::vector<uint32_t>	GetBitmap(uint8_t Fig, uint8_t Rot)
+	{
+		const uint32_t	*pBitmap = GetBitmapTable(Fig, Rot);
+		if (pBitmap == NULL) {
+			return std::vector<uint32_t>();
+		}
+
+		return std::vector<uint32_t>(pBitmap, pBitmap + PIECE_WIDTH);
+
+	} // end of TCPIECE::GetBitmap
+
+	/*!
+		ピースのビットマップ形状を、指定された X 位置にシフトした状態で返します。
+		返される配列には uint32_t が 4 つ（＝PIECE_WIDTH）含まれており、
+		各要素はそのまま TCFIELD の各段のビットマップと AND/OR することができます。
+		配列はあらかじめ計算されたテーブルを指しているため、ヒープの確保は発生しません。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@param[in] PosX 横位置（X 値）
+		@retval すべて 0 の配列 引数異常（X 位置が範囲外のときを含む）
+		@retval シフト済みのビットマップ形状
+	*/
+	static const uint32_t	*GetMask(uint8_t Fig, uint8_t Rot, int8_t PosX)
+	{
+		return GetRowMask<uint32_t>(Fig, Rot, PosX);
+
+	} // end of TCPIECE::GetMask
+
+	/*!
+		ピースのビットマップ形状を、指定された X 位置にシフトした状態で返します。
+		GetMask と同じですが、フィールドの１段を表す整数型 ROW を指定できます（TCFIELDT が使用します）。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@param[in] PosX 横位置（X 値）
+		@retval すべて 0 の配列 引数異常（X 位置が範囲外のときを含む）
+		@retval シフト済みのビットマップ形状（ROW が 4 つ）
+	*/
+	template <typename ROW>
+	static const ROW	*GetRowMask(uint8_t Fig, uint8_t Rot, int8_t PosX)
+	{
+		static const ROW	EmptyMask[PIECE_WIDTH] = { 0, };
+
+		if (
+			(Fig >= FIG_MAX) ||
+			(Rot >= ROT_MAX) ||
+			(PosX < MASK_POS_X_MIN) ||
+			(PosX > MASKTABLE<ROW>::POS_X_MAX)
+		) {
+			return EmptyMask;
+		}
+
+		return GetMaskTable<ROW>().Get(Fig, Rot, PosX);
+
+	} // end of TCPIECE::GetRowMask
+
+	/*!
+		ピースのビットマップ形状を、指定された X 位置にシフトし、４段まとめて 64bit 整数に詰めた状態で返します。
+		返される配列には uint64_t が 2 つ含まれています。
+		フィールドの連続する４段を memcpy で読み出したものと、そのまま AND/OR することができます。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@param[in] PosX 横位置（X 値）
+		@retval すべて 0 の配列 引数異常（X 位置が範囲外のときを含む）
+		@retval シフト済みのビットマップ形状
+	*/
+	static const uint64_t	*GetPackedMask(uint8_t Fig, uint8_t Rot, int8_t PosX)
+	{
+		return GetPackedRowMask<uint32_t>(Fig, Rot, PosX);
+
+	} // end of TCPIECE::GetPackedMask
+
+	/*!
+		ピースのビットマップ形状を、指定された X 位置にシフトし、４段まとめて 64bit 整数に詰めた状態で返します。
+		GetPackedMask と同じですが、フィールドの１段を表す整数型 ROW を指定できます（TCFIELDT が使用します）。
+		返される配列には uint64_t が sizeof(ROW) * PIECE_WIDTH / 8 個（uint16_t なら 1 つ、uint64_t なら 4 つ）含まれています。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@param[in] PosX 横位置（X 値）
+		@retval すべて 0 の配列 引数異常（X 位置が範囲外のときを含む）
+		@retval シフト済みのビットマップ形状
+	*/
+	template <typename ROW>
+	static const uint64_t	*GetPackedRowMask(uint8_t Fig, uint8_t Rot, int8_t PosX)
+	{
+		static const uint64_t	EmptyMask[PIECE_WIDTH] = { 0, };
+
+		if (
+			(Fig >= FIG_MAX) ||
+			(Rot >= ROT_MAX) ||
+			(PosX < MASK_POS_X_MIN) ||
+			(PosX > MASKTABLE<ROW>::POS_X_MAX)
+		) {
+			return EmptyMask;
+		}
+
+		return GetMaskTable<ROW>().GetPacked(Fig, Rot, PosX);
+
+	} // end of TCPIECE::GetPackedRowMask
+
+	/*!
+		ピースの各マスの位置を、ピースの最も右の列を基準にした相対位置で返します。
+		すべての X 位置についてまとめて当たり判定をするとき（TCFIELD::GetDropY など）に使用します。
+		どの形状もマスは４つ（＝PIECE_WIDTH）です。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@param[out] CellX 各マスの、ピースの最も右の列からの横の距離
+		@param[out] CellY 各マスの、ピースの Y 位置からの縦の距離
+		@retval -1 引数異常
+		@retval 0～3 ピースの X 位置から、ピースの最も右の列までの距離
+	*/
+	static int8_t	GetCells(uint8_t Fig, uint8_t Rot, int8_t CellX[PIECE_WIDTH], int8_t CellY[PIECE_WIDTH])
+	{
+		const uint32_t	*pBitmap = GetBitmapTable(Fig, Rot);
+		if (pBitmap == NULL) {
+			return -1;
+		}
+
+		int8_t	OfsX = static_cast<int8_t>(TCBIT::FindLowest(pBitmap[0] | pBitmap[1] | pBitmap[2] | pBitmap[3]));
+		size_t	Cells = 0;
+		for (int8_t yy = 0; yy < PIECE_WIDTH; yy++) {
+			for (uint32_t cell = pBitmap[yy]; cell && (Cells < PIECE_WIDTH); cell &= cell - 1) {
+				CellX[Cells] = static_cast<int8_t>(TCBIT::FindLowest(cell) - OfsX);
+				CellY[Cells] = yy;
+				Cells++;
+			}
+		}
+		return OfsX;
+
+	} // end of TCPIECE::GetCells
+
+	/*!
+		ピースの状態（形状・回転状態・位置）のハッシュ値を取得します。
+		@return ハッシュ値
+	*/
+	uint64_t	GetHash() const
+	{
+		return TCHASH::Mix(
+			(static_cast<uint64_t>(m_Fig) << 24) |
+			(static_cast<uint64_t>(m_Rot) << 16) |
+			(static_cast<uint64_t>(static_cast<uint8_t>(m_Pos.GetX())) << 8) |
+			static_cast<uint64_t>(static_cast<uint8_t>(m_Pos.GetY()))
+		);
+
+	} // end of TCPIECE::GetHash
+
+	/*!
+		最初に呼ばれたときに構築するテーブル（シフト済みのビットマップ形状、ハッシュ値のキー）を、すべて構築しておきます。
+		VC++ の関数内 static 変数の初期化はスレッドセーフでないため、
+		複数のスレッドからフィールドやピースを操作する前に、メインスレッドで一度呼んでおかなければなりません。
+		テーブルは実行ファイル・DLL ごとに持つので、それぞれのモジュール内で呼ぶ必要があります。
+	*/
+	static void	Prepare()
+	{
+		GetMaskTable<uint16_t>();
+		GetMaskTable<uint32_t>();
+		GetMaskTable<uint64_t>();
+		TCHASH::GetCellKey(0, 0);
+
+	} // end of TCPIECE::Prepare
+
+private:
+	/*!
+		シフト済みのビットマップ形状を保持しているテーブルを返します。
+		テーブルは、フィールドの１段を表す整数型ごとに、最初に呼ばれたときに一度だけ構築されます。
+		@return テーブル
+	*/
+	template <typename ROW>
+	static const MASKTABLE<ROW>	&GetMaskTable()
+	{
+		static const MASKTABLE<ROW>	MaskTable;
+		return MaskTable;
+
+	} // end of TCPIECE::GetMaskTable
+
+	/*!
+		ピースのビットマップ形状を保持しているテーブルを返します。
+		ビットマップ形状の並びは GetBitmap と同じです。
+		@param[in] Fig ピースの形状
+		@param[in] Rot ピースの回転状態
+		@retval NULL 引数異常
+		@retval ビットマップ形状（PIECE_WIDTH 個の配列）
+	*/
+	static const uint32_t	*GetBitmapTable(uint8_t Fig, uint8_t Rot)
 	{
 		static const uint32_t	PieceBitmap[FIG_MAX][ROT_MAX][PIECE_WIDTH] = {
 			{	// FIG_O
@@ -737,17 +988,14 @@ public:
 			(Fig >= FIG_MAX) ||
 			(Rot >= ROT_MAX)
 		) {
-			return std::vector<uint32_t>();
+			return NULL;
 		}
 
-		std::vector<uint32_t>	Value;
-		for (int8_t ii = 0; ii < PIECE_WIDTH; ii++) {
-			Value.push_back(PieceBitmap[Fig][Rot][ii]);
-		}
-		return Value;
+		return PieceBitmap[Fig][Rot];
 
-	} // end of TCPIECE::GetBitmap
+	} // end of TCPIECE::GetBitmapTable
 
+public:
 	/*!
 		ピースを指定位置に移動させたときのインスタンスを返します。
 		@param[in] PosX 横位置（X 値）
@@ -817,10 +1065,6 @@ public:
 	} // end of TCPIECE::Rotate
 };
 
-#ifdef TCDECLARE_OBJECT
-TCSIZE	TCPIECE::m_FieldSize = TCSIZE(10, 20);
-#endif	// TCDECLARE_OBJECT
-
 
 
 //----------------------------------------------------------------------------
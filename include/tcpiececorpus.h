@@ -0,0 +1,330 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCPIECECORPUS_H
+#define TCPIECECORPUS_H
+//! @file
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "tctype.h"
+#include "tcpath.h"
+#include "tcpiece.h"
+#include "tcpiecesequence.h"
+
+//----------------------------------------------------------------------------
+/*!
+	ピース列をまとめたファイル（コーパス）を、メモリにマップして読み出すためのクラスです。
+	ファイルは、ヘッダに続けて同じ長さのピース列を並べたもので、ピース１つを 3bit で表します。
+	ピース列は、先頭のピースから順に下位ビットから詰め、１バイト単位に切り上げた長さで並べます。
+	マップしたページは OS が共有するので、同じコーパスを開く複数のプロセスでメモリを重複して消費しません。
+*/
+class TCPIECECORPUS
+{
+	//
+	// assign
+	//
+public:
+	static const uint32_t	VERSION = 1;			//!< ファイル形式のバージョン
+	static const size_t		BITS_PER_PIECE = 3;		//!< ピース１つを表すビット数
+
+	/*!
+		ファイルの先頭に置かれるヘッダです（数値はすべてリトルエンディアン）。
+	*/
+	struct HEADER
+	{
+		char		m_Magic[4];		//!< ファイルの識別子（"TCPS"）
+		uint32_t	m_Version;		//!< ファイル形式のバージョン
+		uint32_t	m_Count;		//!< ピース列の数
+		uint32_t	m_Length;		//!< ピース列１つあたりのピースの数
+	};
+
+	//
+	// variable
+	//
+private:
+	HANDLE			m_hFile;		//!< ファイルのハンドル
+	HANDLE			m_hMapping;		//!< ファイルマッピングのハンドル
+	const uint8_t	*m_pView;		//!< マップしたファイルの先頭
+	HEADER			m_Header;		//!< ヘッダ
+
+	//
+	// method
+	//
+public:
+	/*!
+		デフォルトコンストラクタです。
+		コーパスは開いていない状態になります。
+	*/
+	TCPIECECORPUS()
+		: m_hFile(INVALID_HANDLE_VALUE),
+		m_hMapping(NULL),
+		m_pView(NULL),
+		m_Header()
+	{
+	} // end of TCPIECECORPUS::ctor
+
+	/*!
+		デストラクタです。
+		Close が実行されます。
+	*/
+	~TCPIECECORPUS()
+	{
+		Close();
+
+	} // end of TCPIECECORPUS::dtor
+
+	/*!
+		コーパスを開いて、メモリにマップします。
+		@param[in] strPath ファイル名
+		@retval true 成功
+		@retval false 失敗（ファイルが見つからない or マップできない or 形式が異なる）
+	*/
+	bool	Open(const char *strPath)
+	{
+		Close();
+
+		m_hFile = CreateFileA(TCPATH(strPath).Get().c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (m_hFile == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+
+		DWORD	FileSize = GetFileSize(m_hFile, NULL);
+		if (
+			(FileSize == INVALID_FILE_SIZE) ||
+			(FileSize < sizeof(HEADER))
+		) {
+			Close();
+			return false;
+		}
+
+		m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (!m_hMapping) {
+			Close();
+			return false;
+		}
+
+		m_pView = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+		if (!m_pView) {
+			Close();
+			return false;
+		}
+
+		memcpy(&m_Header, m_pView, sizeof(HEADER));
+		if (
+			(memcmp(m_Header.m_Magic, "TCPS", sizeof(m_Header.m_Magic)) != 0) ||
+			(m_Header.m_Version != VERSION) ||
+			(m_Header.m_Count == 0) ||
+			(m_Header.m_Length == 0) ||
+			(FileSize < sizeof(HEADER) + static_cast<uint64_t>(m_Header.m_Count) * GetRecordSize(m_Header.m_Length))
+		) {
+			Close();
+			return false;
+		}
+
+		// 範囲外のピースがあると形状のテーブルを越えて参照するので、ファイルごと受け付けない
+		size_t	RecordSize = GetRecordSize(m_Header.m_Length);
+		for (size_t idx = 0; idx < m_Header.m_Count; idx++) {
+			const uint8_t	*pRecord = m_pView + sizeof(HEADER) + idx * RecordSize;
+			for (size_t ii = 0; ii < m_Header.m_Length; ii++) {
+				if (DecodeFig(pRecord, ii) >= TCPIECE::FIG_MAX) {
+					Close();
+					return false;
+				}
+			}
+		}
+
+		return true;
+
+	} // end of TCPIECECORPUS::Open
+
+	/*!
+		マップしたファイルを閉じます。
+		デストラクタから実行されているので、このメソッドをコールしなくてもリソースリークは発生しません。
+	*/
+	void	Close()
+	{
+		if (m_pView) {
+			UnmapViewOfFile(m_pView);
+			m_pView = NULL;
+		}
+
+		if (m_hMapping) {
+			CloseHandle(m_hMapping);
+			m_hMapping = NULL;
+		}
+
+		if (m_hFile != INVALID_HANDLE_VALUE) {
+			CloseHandle(m_hFile);
+			m_hFile = INVALID_HANDLE_VALUE;
+		}
+
+		memset(&m_Header, 0, sizeof(HEADER));
+
+	} // end of TCPIECECORPUS::Close
+
+	/*!
+		コーパスを開いているかどうかを返します。
+		@retval true 開いている
+		@retval false 開いていない
+	*/
+	bool	IsOpen() const
+	{
+		return m_pView != NULL;
+
+	} // end of TCPIECECORPUS::IsOpen
+
+	/*!
+		ピース列の数を返します。
+		@return ピース列の数
+	*/
+	size_t	GetCount() const
+	{
+		return m_Header.m_Count;
+
+	} // end of TCPIECECORPUS::GetCount
+
+	/*!
+		ピース列１つあたりのピースの数を返します。
+		@return ピースの数
+	*/
+	size_t	GetLength() const
+	{
+		return m_Header.m_Length;
+
+	} // end of TCPIECECORPUS::GetLength
+
+	/*!
+		指定された順番のピース列を取り出します。
+		順番がピース列の数を超えたときは、先頭に戻って繰り返します。
+		@param[in] Idx ピース列の順番（0～）
+		@return ピース列
+	*/
+	TCPIECESEQUENCE	GetSequence(size_t Idx) const
+	{
+		TCASSERT(IsOpen(), "corpus not opened.");
+
+		size_t			Length = m_Header.m_Length;
+		const uint8_t	*pRecord = m_pView + sizeof(HEADER) + (Idx % m_Header.m_Count) * GetRecordSize(Length);
+		std::vector<uint8_t>	Figs(Length);
+		for (size_t ii = 0; ii < Length; ii++) {
+			Figs[ii] = DecodeFig(pRecord, ii);
+		}
+		return TCPIECESEQUENCE(Figs);
+
+	} // end of TCPIECECORPUS::GetSequence
+
+	/*!
+		ピース列をまとめて、コーパスとしてファイルに書き出します。
+		ピース列が指定された長さより短いときは、先頭に戻って繰り返したものを書き出します。
+		@param[in] strPath ファイル名
+		@param[in] Sequences ピース列の配列
+		@param[in] Length ピース列１つあたりのピースの数
+		@retval true 成功
+		@retval false 失敗
+	*/
+	static bool	Save(const char *strPath, const std::vector<TCPIECESEQUENCE> &Sequences, size_t Length)
+	{
+		if (
+			Sequences.empty() ||
+			(Length == 0)
+		) {
+			return false;
+		}
+
+		std::ofstream	File;
+		File.open(TCPATH(strPath).Get().c_str(), std::ios::out | std::ios::binary);
+		if (!File.is_open()) {
+			return false;
+		}
+
+		HEADER	Header;
+		memcpy(Header.m_Magic, "TCPS", sizeof(Header.m_Magic));
+		Header.m_Version = VERSION;
+		Header.m_Count = static_cast<uint32_t>(Sequences.size());
+		Header.m_Length = static_cast<uint32_t>(Length);
+		File.write(reinterpret_cast<const char*>(&Header), sizeof(HEADER));
+
+		std::vector<uint8_t>	Record(GetRecordSize(Length));
+		for (size_t idx = 0; idx < Sequences.size(); idx++) {
+			std::fill(Record.begin(), Record.end(), 0);
+			for (size_t ii = 0; ii < Length; ii++) {
+				size_t	Bit = ii * BITS_PER_PIECE;
+				size_t	Value = Sequences[idx].GetFig(ii);
+				Record[Bit / 8] |= static_cast<uint8_t>(Value << (Bit % 8));
+				if ((Bit % 8) + BITS_PER_PIECE > 8) {
+					Record[Bit / 8 + 1] |= static_cast<uint8_t>(Value >> (8 - (Bit % 8)));
+				}
+			}
+			File.write(reinterpret_cast<const char*>(&Record[0]), static_cast<std::streamsize>(Record.size()));
+		}
+
+		return File.good();
+
+	} // end of TCPIECECORPUS::Save
+
+private:
+	/*!
+		ピース列１つ分のバイト数を返します。
+		@param[in] Length ピース列１つあたりのピースの数
+		@return バイト数
+	*/
+	static size_t	GetRecordSize(size_t Length)
+	{
+		return (Length * BITS_PER_PIECE + 7) / 8;
+
+	} // end of TCPIECECORPUS::GetRecordSize
+
+	/*!
+		ピース列１つ分のデータから、指定された順番のピースを取り出します。
+		@param[in] pRecord ピース列の先頭
+		@param[in] Idx ピースの順番（0～）
+		@return ピースの形状（検査していないので、TCPIECE::FIG_MAX 以上のこともある）
+	*/
+	static uint8_t	DecodeFig(const uint8_t *pRecord, size_t Idx)
+	{
+		size_t	Bit = Idx * BITS_PER_PIECE;
+		size_t	Value = pRecord[Bit / 8] >> (Bit % 8);
+		if ((Bit % 8) + BITS_PER_PIECE > 8) {
+			Value |= pRecord[Bit / 8 + 1] << (8 - (Bit % 8));
+		}
+		return static_cast<uint8_t>(Value & ((1U << BITS_PER_PIECE) - 1));
+
+	} // end of TCPIECECORPUS::DecodeFig
+
+	// コピー禁止（マップしたファイルを二重に閉じないため）
+	TCPIECECORPUS(const TCPIECECORPUS &);
+	TCPIECECORPUS	&operator=(const TCPIECECORPUS &);
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCPIECECORPUS_H
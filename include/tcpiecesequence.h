@@ -0,0 +1,126 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCPIECESEQUENCE_H
+#define TCPIECESEQUENCE_H
+//! @file
+
+#include <vector>
+#include "tctype.h"
+#include "tcpiece.h"
+#include "tcrandomgenerator.h"
+#include "tcscore.h"
+
+//----------------------------------------------------------------------------
+/*!
+	１ラウンド分の落下ピースの形状の並び（ピース列）を保持するクラスです。
+	ラウンドの開始前に一度だけ生成しておき、同じラウンドのプレイフィールドはすべてこれを参照します。
+	生成後は読み出しのみなので、複数のスレッドから同時に参照できます。
+	乱数ジェネレータから生成したピース列は、同じ乱数ジェネレータからピースを１つずつ生成したときと同じ並びになります。
+*/
+class TCPIECESEQUENCE
+{
+	//
+	// variable
+	//
+private:
+	std::vector<uint8_t>	m_Figs;		//!< ピースの形状の並び
+
+	//
+	// method
+	//
+public:
+	/*!
+		空のピース列を作るコンストラクタです。
+	*/
+	TCPIECESEQUENCE()
+		: m_Figs()
+	{
+	} // end of TCPIECESEQUENCE::ctor
+
+	/*!
+		乱数ジェネレータからピース列を生成するコンストラクタです。
+		@param[in] Random 乱数ジェネレータ（コピーして使うので、状態は変わらない）
+		@param[in] Count 生成するピースの数
+	*/
+	TCPIECESEQUENCE(const TCRANDOMGENERATOR &Random, size_t Count)
+		: m_Figs(Count)
+	{
+		TCRANDOMGENERATOR	randgen(Random);
+		for (size_t ii = 0; ii < Count; ii++) {
+			m_Figs[ii] = static_cast<uint8_t>(randgen.Get() % TCPIECE::FIG_MAX);	// TCPIECE::Randomize と同じ
+		}
+
+	} // end of TCPIECESEQUENCE::ctor
+
+	/*!
+		ピースの形状の並びからピース列を作るコンストラクタです。
+		@param[in] Figs ピースの形状の並び
+	*/
+	explicit TCPIECESEQUENCE(const std::vector<uint8_t> &Figs)
+		: m_Figs(Figs)
+	{
+	} // end of TCPIECESEQUENCE::ctor
+
+	/*!
+		ピース列の長さを返します。
+		@return ピースの数
+	*/
+	size_t	GetCount() const
+	{
+		return m_Figs.size();
+
+	} // end of TCPIECESEQUENCE::GetCount
+
+	/*!
+		指定された順番のピースの形状を返します。
+		ピース列の長さを超えたときは、先頭に戻って繰り返します。
+		@param[in] Idx ピースの順番（0～）
+		@return ピースの形状
+	*/
+	uint8_t	GetFig(size_t Idx) const
+	{
+		TCASSERT(!m_Figs.empty(), "empty sequence.");
+		return m_Figs[Idx % m_Figs.size()];
+
+	} // end of TCPIECESEQUENCE::GetFig
+
+	/*!
+		１ラウンドで使われる可能性のあるピースの数を返します。
+		最初のコントロールピースとネクストピースの分、ラウンドの上限ピース数より２つ多くなります。
+		@return ピースの数
+	*/
+	static size_t	GetRoundCount()
+	{
+		return static_cast<size_t>(TCSCORE().GetRoundPieces()) + 2;
+
+	} // end of TCPIECESEQUENCE::GetRoundCount
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCPIECESEQUENCE_H
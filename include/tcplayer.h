@@ -36,7 +36,8 @@
 #include "tcstring.h"
 
 //----------------------------------------------------------------------------
-class TCFIELD;
+template <typename ROW_T> class TCFIELDT;
+typedef TCFIELDT<uint32_t>	TCFIELD;
 class TCPIECE;
 
 /*!
@@ -46,7 +47,7 @@ class TCPIECE;
 #define TCDECLARE_TCPLAYER()	\
 	extern "C"	__declspec(dllexport)	const char*	_cdecl	tcGetName();\
 	extern "C"	__declspec(dllexport)	const char*	_cdecl	tcGetAuthor();\
-	extern "C"	__declspec(dllexport)	TCPLAYER*	_cdecl	tcCreateInstance(const char *strPath, const char *strRule);
+	extern "C"	__declspec(dllexport)	TCPLAYER*	_cdecl	tcCreateInstance(const char *strPath, const char *strRule, size_t InstanceId);
 
 /*!
 	派生させた TCPLAYER を DLL で実装するときに必要となるクラス定義をまとめたマクロです。
@@ -73,6 +74,7 @@ class TCPIECE;
 	第 2 仮引数は派生クラスのプログラム名（文字列）。
 	第 3 仮引数は派生クラスのバージョン番号（文字列）。
 	第 4 仮引数は派生クラスの作者（文字列）。
+	派生クラスは、TCPLAYER と同じ引数（ワークパス・ルール・インスタンス ID）を受け取るコンストラクタを持たなければなりません。
 */
 #define TCEXPORT_TCPLAYER(USER_PLAYER_T, Name, Author)	\
 	__declspec(dllexport)	const char*	_cdecl	tcGetName()\
@@ -87,11 +89,11 @@ class TCPIECE;
 		return (Author);\
 	}\
 	\
-	__declspec(dllexport)	TCPLAYER*	_cdecl	tcCreateInstance(const char *strPath, const char *strRule)\
+	__declspec(dllexport)	TCPLAYER*	_cdecl	tcCreateInstance(const char *strPath, const char *strRule, size_t InstanceId)\
 	{\
-		return USER_PLAYER_T::IsAvailable(strRule) ? new USER_PLAYER_T(strPath, strRule) : NULL;\
-	}\
-	size_t	TCPLAYER::m_InstanceCount = 0;
+		TCPIECE::Prepare();\
+		return USER_PLAYER_T::IsAvailable(strRule) ? new USER_PLAYER_T(strPath, strRule, InstanceId) : NULL;\
+	}
 
 
 
@@ -108,10 +110,8 @@ class TCPLAYER
 	//
 	// variable
 	//
-private:
-	static size_t			m_InstanceCount;	//!< 生成されたインスタンスの数
 protected:
-	size_t					m_InstanceId;		//!< 同じ思考ルーチンから生成された複数のインスタンスを区別するための ID（0～）
+	size_t					m_InstanceId;		//!< 同じ思考ルーチンから生成された複数のインスタンスを区別するための ID（0～。ゲームに登録された順に、ゲーム側が割り当てる）
 	std::string				m_Path;				//!< 使用すべきワークパス
 	std::string				m_Rule;				//!< 競技ルール
 
@@ -127,11 +127,14 @@ public:
 
 	/*!
 		思考ルーチン（＝プレイヤ）のコンストラクタです。
+		ゲーム側が複数のラウンドを並列に実行するときは、同じ InstanceId のインスタンスが同時に存在することがあります。
+		InstanceId ごとのファイルなど、インスタンスの外にあるものは、同時に存在するインスタンスで衝突しないようにしなければなりません。
 		@param[in] strPath ワークとして使用できるパス
 		@param[in] strRule 与えられたルール（「LONGRUN」「VERSUS」など）
+		@param[in] InstanceId 同じ思考ルーチンから生成された複数のインスタンスを区別するための ID（0～）
 	*/
-	TCPLAYER(const char *strPath, const char *strRule)
-		: m_InstanceId(m_InstanceCount++),
+	TCPLAYER(const char *strPath, const char *strRule, size_t InstanceId)
+		: m_InstanceId(InstanceId),
 		m_Path(strPath),
 		m_Rule(strRule)
 	{
@@ -191,6 +194,33 @@ public:
 		@return プレイヤ入力イベント
 	*/
 	virtual TCEVENT Exec(TCEVENT Event, const TCFIELD &Field, const TCPIECE &CtrlPiece, const TCPIECE &NextPiece) = 0;
+
+	/*!
+		思考ルーチンに対し、落下ピースの配置（最終的に置きたい形状・回転状態・X 位置・Y 位置）を要求します。
+		配置を返すと、ゲーム側がそこで固まるまでのプレイヤ入力（回転・移動）を重力・接地の係数も含めて探索し、
+		１フレームずつ与えるので、そのピースの落下中は Exec が呼ばれなくなります。
+		ピースが出現するフレーム（TCEVENT_PREP）にだけ呼ばれます。
+		配置はピースが着地する位置（それ以上落下できない位置）でなければなりません。ピースは重力で落下するので、落下を早めることはありません。
+		配置を返さなかったとき、形状が操作中のピースと異なるとき、着地する位置でないとき、そこで固まる入力がないときは、
+		そのピースはすべて Exec で入力することになります。
+		@param[in] Event 前のフレーム（プレイヤ入力）以降に発生したイベント（シーケンス＋入力フィードバック）
+		@param[in] Field フィールドのインスタンス
+		@param[in] CtrlPiece 操作中の落下ピースのインスタンス
+		@param[in] NextPiece 次の落下ピースのインスタンス
+		@param[out] Target 配置
+		@retval true 配置を返した
+		@retval false 配置を返さない（Exec で入力する）
+	*/
+	virtual bool	GetPlacement(TCEVENT /*Event*/, const TCFIELD & /*Field*/, const TCPIECE & /*CtrlPiece*/, const TCPIECE & /*NextPiece*/, TCPIECE & /*Target*/) { return false; }
+
+	/*!
+		思考ルーチンの Exec・GetPlacement が、同じ引数で続けて呼ばれたときに同じ結果を返し、内部状態も変えないかどうかを返します。
+		true を返す思考ルーチンに対しては、ゲーム側がピース落下中の変化のないフレームの呼び出しを省略することがあります（早送り）。
+		フレーム数を数えるなど、呼び出し回数に依存する思考ルーチンは false を返さなければなりません。
+		@retval true 同じ引数に対して同じプレイヤ入力を返す
+		@retval false 呼び出しを省略してはならない
+	*/
+	virtual bool	IsStationary() const { return false; }
 };
 
 
@@ -54,15 +54,16 @@ private:
 	/*!
 		DLL に含まれる TCPLAYER インスタンスを生成するインタフェースの型です。
 	*/
-	typedef TCPLAYER*(_cdecl *PFCREATEINSTANCE)(const char *strPath, const char *strRule);
+	typedef TCPLAYER*(_cdecl *PFCREATEINSTANCE)(const char *strPath, const char *strRule, size_t InstanceId);
 
 	//
 	// variable
 	//
 private:
-	HINSTANCE		m_hDll;		//!< DLL のハンドル
-	TCPLAYER		*m_pPlayer;	//!< TCPLAYER のインスタンス
-	TCPATH			m_LibName;	//!< DLL のファイル名
+	HINSTANCE		m_hDll;			//!< DLL のハンドル
+	TCPLAYER		*m_pPlayer;		//!< TCPLAYER のインスタンス
+	TCPATH			m_LibName;		//!< DLL のファイル名
+	size_t			m_InstanceId;	//!< 生成するインスタンスに渡す ID（同じ DLL から生成する複数のインスタンスを区別するため）
 
 	//
 	// method
@@ -72,11 +73,13 @@ public:
 		デフォルトコンストラクタです。
 		各メンバはゼロで初期化されます。
 		@param[in] strLibName DLL のファイル名
+		@param[in] InstanceId 生成するインスタンスに渡す ID（0～。省略時は 0）
 	*/
-	TCPLAYERDLL(const char *strLibName)
+	TCPLAYERDLL(const char *strLibName, size_t InstanceId = 0)
 		: m_hDll(NULL),
 		m_pPlayer(NULL),
-		m_LibName(strLibName)
+		m_LibName(strLibName),
+		m_InstanceId(InstanceId)
 	{
 	} // end of TCPLAYERDLL::ctor
 
@@ -122,7 +125,7 @@ public:
 			return false;
 		}
 
-		m_pPlayer = pfCreateInstance(m_LibName.Get().c_str(), strRule);
+		m_pPlayer = pfCreateInstance(m_LibName.Get().c_str(), strRule, m_InstanceId);
 		if (!m_pPlayer) {
 			return false;
 		}
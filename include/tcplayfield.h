@@ -33,10 +33,14 @@
 #include <algorithm>
 #include <string>
 #include <strstream>
+#include <vector>
 #include "tctype.h"
+#include "tcbit.h"
 #include "tcevent.h"
 #include "tcfield.h"
+#include "tchash.h"
 #include "tcpiece.h"
+#include "tcpiecesequence.h"
 #include "tcplayer.h"
 #include "tcrandomgenerator.h"
 #include "tcscore.h"
@@ -55,6 +59,7 @@ class TCPLAYFIELD
 private:
 	static const size_t		LAND_BONUS_FRAME = 10;		//!< ピースが接地した瞬間に取得できるボーナスフレーム数
 	static const ssize_t	PENALTY_ON_EXCEPTION = 100;	//!< 例外排出時のペナルティ
+	static const size_t		FRAMES_MAX = ~static_cast<size_t>(0);	//!< いつまでも変化が起こらないときのフレーム数
 
 	enum TCSEQ
 	{
@@ -67,17 +72,100 @@ private:
 		SEQ_MAX
 	};
 
+	/*!
+		プレイヤが返した配置までの入力を探索するときの、ノードです。
+	*/
+	struct PATHNODE
+	{
+		static const size_t	HOVER_MAX = 10;							//!< 重力の係数の頭打ち（これ以上は以降の進み方が変わらない）
+		static const size_t	PARENT_NONE = ~static_cast<size_t>(0);	//!< 親ノードがない（ピースの出現時のフレーム）
+
+		TCPIECE		m_Piece;		//!< 操作中のピース
+		uint8_t		m_HoverFrame;	//!< 重力の係数（HOVER_MAX で頭打ち）
+		uint8_t		m_LandFrame;	//!< 接地の係数（LAND_BONUS_FRAME で頭打ち）
+		TCEVENT		m_Input;		//!< このノードに至ったフレームの入力
+		size_t		m_Parent;		//!< 親ノードの位置
+	};
+
+public:
+	/*!
+		プレイフィールドの状態を、コピーせずに読み出すための軽量なビューです（画面出力・成績の集計などから使う）。
+		取得してから、次にプレイフィールドを進行させる（または破棄する）までの状態を表します。
+		ビュー自体はポインタ１つ分なので、値渡しで構いません。
+	*/
+	class SNAPSHOT
+	{
+		//
+		// variable
+		//
+	private:
+		const TCPLAYFIELD	*m_pPlayField;	//!< 参照先のプレイフィールド
+
+		//
+		// method
+		//
+	public:
+		explicit SNAPSHOT(const TCPLAYFIELD &PlayField)
+			: m_pPlayField(&PlayField)
+		{
+		} // end of TCPLAYFIELD::SNAPSHOT::ctor
+
+		bool	IsPlaying() const
+		{
+			return m_pPlayField->IsPlaying();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::IsPlaying
+
+		const TCSCORE	&GetScore() const
+		{
+			return m_pPlayField->GetScore();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::GetScore
+
+		const TCFIELD	&GetField() const
+		{
+			return m_pPlayField->GetField();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::GetField
+
+		const TCPIECE	&GetCtrlPiece() const
+		{
+			return m_pPlayField->GetCtrlPiece();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::GetCtrlPiece
+
+		const TCPIECE	&GetNextPiece() const
+		{
+			return m_pPlayField->GetNextPiece();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::GetNextPiece
+
+		uint64_t	GetHash() const
+		{
+			return m_pPlayField->GetHash();
+
+		} // end of TCPLAYFIELD::SNAPSHOT::GetHash
+	};
+
 	//
 	// variable
 	//
 private:
 	TCRANDOMGENERATOR		m_Random;		//!< 乱数ジェネレータ
+	const TCPIECESEQUENCE	*m_pSequence;	//!< ピース列（NULL なら乱数ジェネレータでピースを生成する）
+	size_t					m_SequenceIdx;	//!< 次に出現させるピースの、ピース列での順番
 	TCSEQ					m_Seq;			//!< ゲームシーケンス
 	ssize_t					m_SeqFrame;		//!< 同じゲームシーケンスを何フレーム継続しているか
 	size_t					m_HoverFrame;	//!< 次のピース落下（１段）までの係数（移動直後は 0、同じ高さにとどまると重力係数に応じて増加し、10 を超えると１段落下、20 を超えると２段落下する）
 	size_t					m_LandFrame;	//!< ピースが接地してから固まるまでの係数（接地していなかったら 0、接地したら 1 から増加し、ボーナスフレーム数を超えると固まる）
 	size_t					m_SpotCount;	//!< フィールドに存在するスポット面積
+	uint32_t				m_LinesMask;	//!< 最後に固まったピースで揃ったラインの位置（SEQ_CHECK・SEQ_LINE_OUT 時のみ有効）
 	TCEVENT					m_NextEvent;	//!< 次のフレームでプレイヤに渡すべきイベント
+	bool					m_bQuiet;		//!< 直前のフレームが、プレイヤに渡すもの（イベント・フィールド・ピース）を何も変えなかった落下中のフレームかどうか
+	bool					m_bPlacement;	//!< 操作中のピースを、プレイヤが返した配置に向けてゲーム側で入力しているかどうか
+	TCPIECE					m_Target;		//!< プレイヤが返した配置（m_bPlacement が true のときのみ有効）
+	std::vector<TCEVENT>	m_Path;			//!< 配置で固まるまでの、フレームごとのプレイヤ入力（m_bPlacement が true のときのみ有効）
+	size_t					m_PathIdx;		//!< 次のフレームで与える入力の、m_Path での位置
 	TCFIELD					m_Field;		//!< フィールド
 	TCPIECE					m_CtrlPiece;	//!< 操作中の落下ピース（SEQ_CHECK 時は参照できない）
 	TCPIECE					m_NextPiece;	//!< 次の落下ピース（SEQ_PERP 時は参照できない）
@@ -95,19 +183,25 @@ public:
 	*/
 	TCPLAYFIELD(int8_t Width, int8_t Height, size_t Gravity)
 		: m_Random(0),
+		m_pSequence(NULL),
+		m_SequenceIdx(0),
 		m_Seq(SEQ_NOT_PLAYING),
 		m_SeqFrame(0),
 		m_HoverFrame(0),
 		m_LandFrame(0),
 		m_SpotCount(0),
+		m_LinesMask(0),
 		m_NextEvent(0),
+		m_bQuiet(false),
+		m_bPlacement(false),
+		m_Target(),
+		m_Path(),
+		m_PathIdx(0),
 		m_Field(Width, Height, Gravity),
 		m_CtrlPiece(),
 		m_NextPiece(),
 		m_Score()
 	{
-		TCPIECE::SetField(m_Field.GetSize());
-
 	} // end of TCPLAYFIELD::ctor
 
 	/*!
@@ -117,12 +211,20 @@ public:
 	*/
 	TCPLAYFIELD(const TCPLAYFIELD &Rhs)
 		: m_Random(Rhs.m_Random),
+		m_pSequence(Rhs.m_pSequence),
+		m_SequenceIdx(Rhs.m_SequenceIdx),
 		m_Seq(Rhs.m_Seq),
 		m_SeqFrame(Rhs.m_SeqFrame),
 		m_HoverFrame(Rhs.m_HoverFrame),
 		m_LandFrame(Rhs.m_LandFrame),
 		m_SpotCount(Rhs.m_SpotCount),
+		m_LinesMask(Rhs.m_LinesMask),
 		m_NextEvent(Rhs.m_NextEvent),
+		m_bQuiet(Rhs.m_bQuiet),
+		m_bPlacement(Rhs.m_bPlacement),
+		m_Target(Rhs.m_Target),
+		m_Path(Rhs.m_Path),
+		m_PathIdx(Rhs.m_PathIdx),
 		m_Field(Rhs.m_Field),
 		m_CtrlPiece(Rhs.m_CtrlPiece),
 		m_NextPiece(Rhs.m_NextPiece),
@@ -139,12 +241,20 @@ public:
 	TCPLAYFIELD	&operator=(const TCPLAYFIELD &Rhs)
 	{
 		m_Random = Rhs.m_Random;
+		m_pSequence = Rhs.m_pSequence;
+		m_SequenceIdx = Rhs.m_SequenceIdx;
 		m_Seq = Rhs.m_Seq;
 		m_SeqFrame = Rhs.m_SeqFrame;
 		m_HoverFrame = Rhs.m_HoverFrame;
 		m_LandFrame = Rhs.m_LandFrame;
 		m_SpotCount = Rhs.m_SpotCount;
+		m_LinesMask = Rhs.m_LinesMask;
 		m_NextEvent = Rhs.m_NextEvent;
+		m_bQuiet = Rhs.m_bQuiet;
+		m_bPlacement = Rhs.m_bPlacement;
+		m_Target = Rhs.m_Target;
+		m_Path = Rhs.m_Path;
+		m_PathIdx = Rhs.m_PathIdx;
 		m_Field = Rhs.m_Field;
 		m_CtrlPiece = Rhs.m_CtrlPiece;
 		m_NextPiece = Rhs.m_NextPiece;
@@ -155,9 +265,10 @@ public:
 
 	/*!
 		プレイ中のプレイヤのラウンド成績を取得します。
+		返すのは参照なので、プレイフィールドを進行させると内容が変わります。
 		@return プレイヤのラウンド成績
 	*/
-	TCSCORE	GetScore() const
+	const TCSCORE	&GetScore() const
 	{
 		return m_Score;
 
@@ -165,9 +276,10 @@ public:
 
 	/*!
 		フィールドの状態を取得します。
+		返すのは参照なので、プレイフィールドを進行させると内容が変わります。
 		@return フィールド
 	*/
-	TCFIELD	GetField() const
+	const TCFIELD	&GetField() const
 	{
 		return m_Field;
 
@@ -189,7 +301,7 @@ public:
 		無効なピース（FIG_VOID）が返されます。
 		@return プレイヤのラウンド成績
 	*/
-	TCPIECE	GetCtrlPiece() const
+	const TCPIECE	&GetCtrlPiece() const
 	{
 		return m_CtrlPiece;
 
@@ -201,12 +313,47 @@ public:
 		無効なピース（FIG_VOID）が返されます。
 		@return プレイヤのラウンド成績
 	*/
-	TCPIECE	GetNextPiece() const
+	const TCPIECE	&GetNextPiece() const
 	{
 		return m_NextPiece;
 
 	} // end of TCPLAYFIELD::GetNextPiece
 
+	/*!
+		状態をコピーせずに読み出すためのビューを取得します。
+		@return ビュー
+	*/
+	SNAPSHOT	GetSnapshot() const
+	{
+		return SNAPSHOT(*this);
+
+	} // end of TCPLAYFIELD::GetSnapshot
+
+	/*!
+		プレイフィールド全体の状態のハッシュ値を取得します。
+		フィールド・コントロールピース・ネクストピース・乱数ジェネレータ（またはピース列の位置）の状態に加えて、
+		ゲームシーケンスと落下・接地のフレーム係数、プレイヤが返した配置とそこまでの残りの入力をまとめたものです。
+		ハッシュ値が同じプレイフィールドは、同じ入力を与えれば以降も同じように進行します。
+		ラウンド成績は以降の進行に影響しないため含みません。
+		フィールドのハッシュ値は差分で更新されているので、呼び出しのコストは小さく抑えられています。
+		@return ハッシュ値
+	*/
+	uint64_t	GetHash() const
+	{
+		uint64_t	Hash = m_Field.GetHash();
+		Hash = TCHASH::Combine(Hash, m_CtrlPiece.GetHash());
+		Hash = TCHASH::Combine(Hash, m_NextPiece.GetHash());
+		Hash = TCHASH::Combine(Hash, m_pSequence ? m_SequenceIdx : m_Random.GetHash());
+		Hash = TCHASH::Combine(Hash, (static_cast<uint64_t>(m_Seq) << 32) | static_cast<uint32_t>(m_SeqFrame));
+		Hash = TCHASH::Combine(Hash, (static_cast<uint64_t>(m_HoverFrame) << 32) | m_LandFrame);
+		Hash = TCHASH::Combine(Hash, m_bPlacement ? m_Target.GetHash() : 0);
+		for (size_t idx = m_bPlacement ? m_PathIdx : m_Path.size(); idx < m_Path.size(); idx++) {
+			Hash = TCHASH::Combine(Hash, m_Path[idx]);
+		}
+		return TCHASH::Combine(Hash, m_NextEvent);
+
+	} // end of TCPLAYFIELD::GetHash
+
 	/*!
 		プレイ中かどうかを返します。
 		@retval true プレイ中である
@@ -240,23 +387,56 @@ public:
 	*/
 	TCEVENT	StartGame(const TCRANDOMGENERATOR &Random, TCPLAYER *pPlayer)
 	{
-		TCASSERT(pPlayer, "fatal.");
-
 		if (m_Seq != SEQ_NOT_PLAYING) {
 			return 0;
 		}
 
 		m_Random = Random;
+		m_pSequence = NULL;
+		return StartGame_Common(pPlayer);
+
+	} // end of TCPLAYFIELD::StartGame
+
+	/*!
+		あらかじめ生成しておいたピース列で、プレイを開始します。
+		すでにプレイ中のときは何もしません。
+		ピース列はプレイ中ずっと参照されるので、プレイが終わるまで破棄してはいけません。
+		@param[in] Sequence ピース列
+		@param[in/out] pPlayer プレイヤ入力のインスタンス
+	*/
+	TCEVENT	StartGame(const TCPIECESEQUENCE &Sequence, TCPLAYER *pPlayer)
+	{
+		if (m_Seq != SEQ_NOT_PLAYING) {
+			return 0;
+		}
+
+		m_pSequence = &Sequence;
+		m_SequenceIdx = 0;
+		return StartGame_Common(pPlayer);
+
+	} // end of TCPLAYFIELD::StartGame
+
+private:
+	TCEVENT	StartGame_Common(TCPLAYER *pPlayer)
+	{
+		TCASSERT(pPlayer, "fatal.");
+
 		m_Seq = SEQ_PREP;
 		m_SeqFrame = 0;
 		m_HoverFrame = 0;
 		m_LandFrame = 0;
 		m_NextEvent = 0;
+		m_bQuiet = false;
+		m_bPlacement = false;
+		m_Target = TCPIECE();
+		m_Path.clear();
+		m_PathIdx = 0;
 		m_SpotCount = 0;
+		m_LinesMask = 0;
 
 		m_Field.StartGame();
-		m_CtrlPiece.Randomize(m_Random);
-		m_NextPiece.Randomize(m_Random);
+		SpawnPiece(m_CtrlPiece);
+		SpawnPiece(m_NextPiece);
 		m_Score.Clear();
 
 		try {
@@ -268,8 +448,24 @@ public:
 
 		return 0;
 
-	} // end of TCPLAYFIELD::StartGame
+	} // end of TCPLAYFIELD::StartGame_Common
+
+	/*!
+		次のピースを出現させます。
+		ピース列があればその順番に、なければ乱数ジェネレータで形状を決めます。
+		@param[out] Piece 出現させたピース
+	*/
+	void	SpawnPiece(TCPIECE &Piece)
+	{
+		if (m_pSequence) {
+			Piece.Spawn(m_pSequence->GetFig(m_SequenceIdx++), m_Field.GetSize());
+		} else {
+			Piece.Randomize(m_Random, m_Field.GetSize());
+		}
+
+	} // end of TCPLAYFIELD::SpawnPiece
 
+public:
 	/*!
 		ゲームを１フレームだけ進行させます。
 		@param[in/out] pPlayer プレイヤ入力のインスタンス
@@ -282,6 +478,7 @@ public:
 		TCEVENT	evt = 0;
 		TCSEQ	SeqOld = m_Seq;
 
+		m_bQuiet = false;
 		try {
 			switch (m_Seq) {
 			case SEQ_NOT_PLAYING:
@@ -324,7 +521,459 @@ public:
 
 	} // end of TCPLAYFIELD::Tick
 
+	/*!
+		観測できる変化が起こるフレームまで、ゲームをまとめて進行させます（早送り）。
+		落下中のフレームでプレイヤ入力が何も変化を起こさなかったとき、次にピースが落下する・固まるフレームの直前までは、
+		プレイヤに渡すものが変わらず、重力と接地の係数が進むだけです。
+		プレイヤが TCPLAYER::IsStationary で true を返すとき、またはプレイヤが返した配置に向けてゲーム側で入力していて、
+		探索した入力が何も入力しないフレームに限り、そのようなフレームの呼び出しを省いて係数だけをまとめて進め、
+		続く変化の起こるフレームを Tick で１フレーム進行させます。
+		結果は１フレームずつ Tick を呼んだときと同じになります。
+		@param[in/out] pPlayer プレイヤ入力のインスタンス
+		@param[in] MaxFrames 進行させるフレーム数の上限（1～）
+		@param[out] Frames 進行させたフレーム数
+		@return 発生した主なイベント
+	*/
+	TCEVENT	Tick(TCPLAYER *pPlayer, size_t MaxFrames, size_t &Frames)
+	{
+		TCASSERT(pPlayer, "fatal.");
+
+		Frames = 0;
+		if (MaxFrames == 0) {
+			return 0;
+		}
+
+		Frames = min(CountSkippableFrames(pPlayer), MaxFrames);
+		SkipQuietFrames(Frames);
+		if (Frames == MaxFrames) {
+			return 0;
+		}
+
+		Frames++;
+		return Tick(pPlayer);
+
+	} // end of TCPLAYFIELD::Tick
+
+	/*!
+		次のフレームから、プレイヤを呼ばずに係数だけを進めればよいフレームが、あと何フレーム続くかを返します（早送り・バッチ進行用）。
+		@param[in] pPlayer プレイヤ入力のインスタンス
+		@return フレーム数（0 なら、次のフレームは Tick で進行させなければならない）
+	*/
+	size_t	CountSkippableFrames(const TCPLAYER *pPlayer) const
+	{
+		TCASSERT(pPlayer, "fatal.");
+
+		if (
+			(m_Seq != SEQ_FALL) ||
+			!m_bQuiet
+		) {
+			return 0;
+		}
+		if (m_bPlacement) {
+			return min(CountQuietFrames(), CountPathIdleFrames());
+		}
+		return pPlayer->IsStationary() ? CountQuietFrames() : 0;
+
+	} // end of TCPLAYFIELD::CountSkippableFrames
+
+	/*!
+		落下中の重力と接地の係数を取得します（バッチ進行用）。
+		@param[out] HoverFrame 重力の係数
+		@param[out] LandFrame 接地の係数
+	*/
+	void	GetFallFrames(size_t &HoverFrame, size_t &LandFrame) const
+	{
+		HoverFrame = m_HoverFrame;
+		LandFrame = m_LandFrame;
+
+	} // end of TCPLAYFIELD::GetFallFrames
+
+	/*!
+		CountSkippableFrames 以下のフレームを、呼び出し側で係数を進めて済ませたときに、その係数を書き戻します（バッチ進行用）。
+		@param[in] HoverFrame 重力の係数
+		@param[in] LandFrame 接地の係数
+		@param[in] Frames 済ませたフレーム数
+	*/
+	void	SetFallFrames(size_t HoverFrame, size_t LandFrame, size_t Frames)
+	{
+		TCASSERT(m_Seq == SEQ_FALL, "unexpected.");
+
+		m_HoverFrame = HoverFrame;
+		m_LandFrame = LandFrame;
+		m_SeqFrame += static_cast<ssize_t>(Frames);
+		if (m_bPlacement) {
+			m_PathIdx += Frames;
+		}
+
+	} // end of TCPLAYFIELD::SetFallFrames
+
 protected:
+	/*!
+		プレイヤ入力を求めます。
+		プレイヤが配置を返すなら、ピースの出現時にだけ配置を求め、そこへ着地するまでのプレイヤ入力をゲーム側で探索して、１フレームずつ与えます。
+		@param[in/out] pPlayer プレイヤ入力のインスタンス
+		@param[in] Event プレイヤに渡すイベント
+		@return プレイヤ入力イベント
+	*/
+	TCEVENT	Exec(TCPLAYER *pPlayer, TCEVENT Event)
+	{
+		if (Event & TCEVENT_PREP) {
+			m_bPlacement = pPlayer->GetPlacement(Event, m_Field, m_CtrlPiece, m_NextPiece, m_Target);
+			m_bPlacement = m_bPlacement && SearchPlacementPath();
+		}
+
+		if (!m_bPlacement) {
+			return pPlayer->Exec(Event, m_Field, m_CtrlPiece, m_NextPiece);
+		}
+		return (m_PathIdx < m_Path.size()) ? m_Path[m_PathIdx++] : 0;
+
+	} // end of TCPLAYFIELD::Exec
+
+	/*!
+		ピースの出現時（TCEVENT_PREP）に、操作中のピースをプレイヤが返した配置で固めるまでのプレイヤ入力を探索します。
+		状態（回転状態・位置・重力と接地の係数）をノードとし、Tick_Prep・Tick_Fall と同じ規則で１フレームずつ進めた幅優先探索です。
+		重力と接地の係数の増え方まで含めて探索するので、見つかった入力をそのまま与えれば、配置で固まることが保証されます。
+		配置が着地する位置でないとき、またはそこで固まる入力がないときは、配置を受け付けません。
+		@retval true 入力を見つけた（m_Path に格納した）
+		@retval false 配置を受け付けない
+	*/
+	bool	SearchPlacementPath()
+	{
+		static const TCEVENT	Inputs[] = {
+			0,
+			TCEVENT_ROT_L,
+			TCEVENT_ROT_R,
+			TCEVENT_MOVE_L,
+			TCEVENT_MOVE_R,
+			TCEVENT_ROT_L | TCEVENT_MOVE_L,
+			TCEVENT_ROT_L | TCEVENT_MOVE_R,
+			TCEVENT_ROT_R | TCEVENT_MOVE_L,
+			TCEVENT_ROT_R | TCEVENT_MOVE_R,
+		};
+		static const size_t		PREP_INPUTS = 3;	// 落下開始前は、回転だけが有効（Inputs の先頭の、入力なし・左回転・右回転）
+
+		m_Path.clear();
+		m_PathIdx = 0;
+
+		if (
+			(m_Target.m_Fig != m_CtrlPiece.m_Fig) ||
+			(m_Target.m_Rot >= TCPIECE::ROT_MAX) ||
+			!m_Field.IsSetPiece(m_Target) ||
+			m_Field.IsSetPiece(m_Target.MoveY(-1))
+		) {
+			return false;
+		}
+
+		std::vector<PATHNODE>	Nodes;
+		std::vector<bool>		Visited(GetPathKeyMax(), false);
+		for (size_t ii = 0; ii < PREP_INPUTS; ii++) {
+			PATHNODE	Node = { m_CtrlPiece, 0, 0, Inputs[ii], PATHNODE::PARENT_NONE };
+			if (SimulatePrep(Node)) {
+				VisitPathNode(Nodes, Visited, Node);
+			}
+		}
+
+		for (size_t idx = 0; idx < Nodes.size(); idx++) {
+			for (size_t ii = 0; ii < sizeof(Inputs) / sizeof(Inputs[0]); ii++) {
+				PATHNODE	Node = { Nodes[idx].m_Piece, Nodes[idx].m_HoverFrame, Nodes[idx].m_LandFrame, Inputs[ii], idx };
+				bool		bLocked = false;
+				if (!SimulateFall(Node, bLocked)) {
+					continue;
+				}
+				if (!bLocked) {
+					VisitPathNode(Nodes, Visited, Node);
+					continue;
+				}
+				if (!IsSamePlacement(Node.m_Piece, m_Target)) {
+					continue;
+				}
+
+				// 固まったフレームから出現時のフレームまで遡る
+				m_Path.push_back(Node.m_Input);
+				for (size_t Parent = idx; Parent != PATHNODE::PARENT_NONE; Parent = Nodes[Parent].m_Parent) {
+					m_Path.push_back(Nodes[Parent].m_Input);
+				}
+				std::reverse(m_Path.begin(), m_Path.end());
+				return true;
+			}
+		}
+		return false;
+
+	} // end of TCPLAYFIELD::SearchPlacementPath
+
+	/*!
+		入力の探索で、まだ訪れていない状態なら、ノードとして追加します。
+		@param[in/out] Nodes ノードの列
+		@param[in/out] Visited 状態ごとの、訪れたかどうか
+		@param[in] Node 追加するノード
+	*/
+	void	VisitPathNode(std::vector<PATHNODE> &Nodes, std::vector<bool> &Visited, const PATHNODE &Node) const
+	{
+		size_t	Key = GetPathKey(Node);
+		if ((Key >= Visited.size()) || Visited[Key]) {
+			return;
+		}
+		Visited[Key] = true;
+		Nodes.push_back(Node);
+
+	} // end of TCPLAYFIELD::VisitPathNode
+
+	/*!
+		入力の探索で、状態を区別するためのキーの上限を返します。
+		@return キーの上限
+	*/
+	size_t	GetPathKeyMax() const
+	{
+		size_t	Width = static_cast<size_t>(m_Field.GetSize().GetX() - TCPIECE::MASK_POS_X_MIN);
+		size_t	Height = static_cast<size_t>(m_Field.GetSize().GetY() + TCPIECE::PIECE_WIDTH);
+		return TCPIECE::ROT_MAX * Width * Height * (PATHNODE::HOVER_MAX + 1) * (LAND_BONUS_FRAME + 1);
+
+	} // end of TCPLAYFIELD::GetPathKeyMax
+
+	/*!
+		入力の探索で、状態を区別するためのキーを返します。
+		@param[in] Node ノード
+		@return キー（範囲外なら GetPathKeyMax 以上）
+	*/
+	size_t	GetPathKey(const PATHNODE &Node) const
+	{
+		ssize_t	PosX = Node.m_Piece.m_Pos.GetX() - TCPIECE::MASK_POS_X_MIN;
+		ssize_t	PosY = Node.m_Piece.m_Pos.GetY() + TCPIECE::PIECE_WIDTH;
+		ssize_t	Width = m_Field.GetSize().GetX() - TCPIECE::MASK_POS_X_MIN;
+		ssize_t	Height = m_Field.GetSize().GetY() + TCPIECE::PIECE_WIDTH;
+		if (
+			(PosX < 0) || (PosX >= Width) ||
+			(PosY < 0) || (PosY >= Height)
+		) {
+			return GetPathKeyMax();
+		}
+
+		size_t	Key = Node.m_Piece.m_Rot;
+		Key = Key * Width + PosX;
+		Key = Key * Height + PosY;
+		Key = Key * (PATHNODE::HOVER_MAX + 1) + Node.m_HoverFrame;
+		Key = Key * (LAND_BONUS_FRAME + 1) + Node.m_LandFrame;
+		return Key;
+
+	} // end of TCPLAYFIELD::GetPathKey
+
+	/*!
+		入力の探索で、Tick_Prep と同じ規則で、ピースの出現時のフレームを進めます。
+		@param[in/out] Node 出現前のピースと、そのフレームの入力（出現後の状態を返す）
+		@retval true ピースが出現した
+		@retval false ピースを置けない（ゲームオーバー）
+	*/
+	bool	SimulatePrep(PATHNODE &Node) const
+	{
+		TCPIECE	&Piece = Node.m_Piece;
+		if (Node.m_Input & TCEVENT_ROT) {
+			Piece = Piece.Rotate((Node.m_Input & TCEVENT_ROT_L) ? +1 : -1);
+		}
+		Piece = Piece.MoveY(Piece.GetTopOfsY());
+		if (!m_Field.IsSetPiece(Piece)) {
+			return false;
+		}
+
+		Node.m_HoverFrame = 0;
+		Node.m_LandFrame = 0;
+		for (size_t yy = 10; yy < m_Field.GetGravity(); yy += 10) {
+			if (!m_Field.IsSetPiece(Piece.MoveY(-1))) {
+				break;
+			}
+			Piece = Piece.MoveY(-1);
+		}
+		if (m_Field.IsSetPiece(Piece.MoveY(-1))) {
+			Node.m_LandFrame = 1;
+		}
+		return true;
+
+	} // end of TCPLAYFIELD::SimulatePrep
+
+	/*!
+		入力の探索で、Tick_Fall と同じ規則で、ピース落下中のフレームを進めます。
+		重力の係数は 10 以上、接地の係数はボーナスフレーム数以上であれば以降の進み方が変わらないので、そこで頭打ちにします。
+		@param[in/out] Node 落下中の状態と、そのフレームの入力（進めた後の状態を返す）
+		@param[out] bLocked ピースが固まったかどうか
+		@retval true 入力どおりに回転・移動できた
+		@retval false 入力が阻まれた（阻まれない入力と同じ結果になるので、探索しない）
+	*/
+	bool	SimulateFall(PATHNODE &Node, bool &bLocked) const
+	{
+		TCPIECE	&Piece = Node.m_Piece;
+		size_t	HoverFrame = Node.m_HoverFrame;
+		size_t	LandFrame = Node.m_LandFrame;
+		bLocked = false;
+
+		if (Node.m_Input & TCEVENT_ROT) {
+			Piece = Piece.Rotate((Node.m_Input & TCEVENT_ROT_L) ? +1 : -1);
+			if (!m_Field.IsSetPiece(Piece)) {
+				return false;
+			}
+		}
+		if (Node.m_Input & TCEVENT_MOVE) {
+			Piece = Piece.MoveX((Node.m_Input & TCEVENT_MOVE_L) ? +1 : -1);
+			if (!m_Field.IsSetPiece(Piece)) {
+				return false;
+			}
+		}
+
+		HoverFrame += m_Field.GetGravity();
+		if (
+			(HoverFrame >= 10) ||
+			(LandFrame >= LAND_BONUS_FRAME)
+		) {
+			for (size_t yy = 0; yy < m_Field.GetGravity(); yy += 10) {
+				if (!m_Field.IsSetPiece(Piece.MoveY(-1))) {
+					if (yy == 0) {
+						if (LandFrame >= LAND_BONUS_FRAME) {
+							bLocked = true;
+						} else {
+							LandFrame++;
+						}
+					}
+					break;
+				}
+				Piece = Piece.MoveY(-1);
+				HoverFrame = 0;
+				LandFrame = 0;
+			}
+			if (m_Field.IsSetPiece(Piece.MoveY(-1))) {
+				if (LandFrame == 0) {
+					LandFrame++;
+				}
+			}
+		} else {
+			if (LandFrame > 0) {
+				LandFrame++;
+			}
+		}
+
+		Node.m_HoverFrame = static_cast<uint8_t>(min(HoverFrame, static_cast<size_t>(PATHNODE::HOVER_MAX)));
+		Node.m_LandFrame = static_cast<uint8_t>(min(LandFrame, LAND_BONUS_FRAME));
+		return true;
+
+	} // end of TCPLAYFIELD::SimulateFall
+
+	/*!
+		２つのピースが、同じマスを占めるかどうかを返します。
+		回転状態が異なっても、形状が同じになる回転状態（FIG_I・FIG_S・FIG_Z の半回転など）なら同じ配置として扱います。
+		@param[in] Lhs ピース
+		@param[in] Rhs ピース
+		@retval true 同じマスを占める
+		@retval false 異なるマスを占める
+	*/
+	static bool	IsSamePlacement(const TCPIECE &Lhs, const TCPIECE &Rhs)
+	{
+		if (
+			(Lhs.m_Fig != Rhs.m_Fig) ||
+			(Lhs.m_Pos.GetY() != Rhs.m_Pos.GetY())
+		) {
+			return false;
+		}
+		if (Lhs.m_Rot == Rhs.m_Rot) {
+			return Lhs.m_Pos.GetX() == Rhs.m_Pos.GetX();
+		}
+
+		int8_t	LhsX[TCPIECE::PIECE_WIDTH], LhsY[TCPIECE::PIECE_WIDTH];
+		int8_t	RhsX[TCPIECE::PIECE_WIDTH], RhsY[TCPIECE::PIECE_WIDTH];
+		int8_t	LhsOfsX = TCPIECE::GetCells(Lhs.m_Fig, Lhs.m_Rot, LhsX, LhsY);
+		int8_t	RhsOfsX = TCPIECE::GetCells(Rhs.m_Fig, Rhs.m_Rot, RhsX, RhsY);
+		return
+			(LhsOfsX >= 0) &&
+			(RhsOfsX >= 0) &&
+			(Lhs.m_Pos.GetX() + LhsOfsX == Rhs.m_Pos.GetX() + RhsOfsX) &&
+			(memcmp(LhsX, RhsX, sizeof(LhsX)) == 0) &&
+			(memcmp(LhsY, RhsY, sizeof(LhsY)) == 0);
+
+	} // end of TCPLAYFIELD::IsSamePlacement
+
+	/*!
+		探索した入力を与えている間、次のフレームから何も入力しないフレームがあと何フレーム続くかを返します。
+		@return フレーム数
+	*/
+	size_t	CountPathIdleFrames() const
+	{
+		size_t	Frames = 0;
+		while ((m_PathIdx + Frames < m_Path.size()) && (m_Path[m_PathIdx + Frames] == 0)) {
+			Frames++;
+		}
+		return Frames;
+
+	} // end of TCPLAYFIELD::CountPathIdleFrames
+
+	/*!
+		重力の係数が 10 に届くのが、何フレーム目になるかを求めます。
+		@return フレーム数（1～。重力係数が 0 でいつまでも届かなければ最大値）
+	*/
+	size_t	CountHoverFrames() const
+	{
+		size_t	Gravity = m_Field.GetGravity();
+		if (m_HoverFrame >= 10) {
+			return 1;
+		}
+		if (Gravity == 0) {
+			return FRAMES_MAX;
+		}
+		return (10 - m_HoverFrame + Gravity - 1) / Gravity;
+
+	} // end of TCPLAYFIELD::CountHoverFrames
+
+	/*!
+		変化のないフレーム（m_bQuiet を参照）が、あと何フレーム続くかを求めます。
+		Tick_Fall の重力と接地の係数の進み方を、フレーム数について解いたものです。
+		@return 変化のないフレーム数（重力係数が 0 で接地もしていなければ、いつまでも続くので最大値）
+	*/
+	size_t	CountQuietFrames() const
+	{
+		size_t	HoverFrames = CountHoverFrames();
+
+		// 接地の係数がボーナスフレーム数に届いた次は何フレーム目か
+		size_t	LandFrames = FRAMES_MAX;
+		if (m_LandFrame > 0) {
+			LandFrames = (m_LandFrame >= LAND_BONUS_FRAME) ? 1 : LAND_BONUS_FRAME - m_LandFrame + 1;
+		}
+
+		if (m_Field.IsSetPiece(m_CtrlPiece.MoveY(-1))) {
+			// 落下できるなら、どちらかの係数が届いたフレームで１段落下する
+			return min(HoverFrames, LandFrames) - 1;
+		}
+
+		// 落下できないなら、接地の係数がボーナスフレーム数に届いた次のフレームで固まる
+		if (m_LandFrame > 0) {
+			return LandFrames - 1;
+		}
+		// 接地の係数は、重力の係数が 10 に届いてから増え始める
+		return (HoverFrames == FRAMES_MAX) ? FRAMES_MAX : HoverFrames + LAND_BONUS_FRAME - 1;
+
+	} // end of TCPLAYFIELD::CountQuietFrames
+
+	/*!
+		変化のないフレームを、プレイヤ入力を要求せずにまとめて進行させます。
+		@param[in] Frames 進行させるフレーム数（CountQuietFrames 以下）
+	*/
+	void	SkipQuietFrames(size_t Frames)
+	{
+		if (Frames == 0) {
+			return;
+		}
+
+		if (m_LandFrame > 0) {
+			m_LandFrame += Frames;
+		} else if (!m_Field.IsSetPiece(m_CtrlPiece.MoveY(-1))) {
+			// 接地の係数は、重力の係数が 10 に届いたフレームから増え始める
+			size_t	HoverFrames = CountHoverFrames();
+			if (HoverFrames <= Frames) {
+				m_LandFrame = Frames - HoverFrames + 1;
+			}
+		}
+		m_HoverFrame += m_Field.GetGravity() * Frames;
+		m_SeqFrame += static_cast<ssize_t>(Frames);
+		if (m_bPlacement) {
+			m_PathIdx += Frames;
+		}
+
+	} // end of TCPLAYFIELD::SkipQuietFrames
+
 	TCSEQ	Tick_NotPlaying(TCPLAYER *pPlayer, TCEVENT &evt)
 	{
 		return SEQ_NOT_PLAYING;
@@ -345,12 +994,12 @@ protected:
 		//
 		m_NextEvent &= TCEVENT_MASK_PRE;
 		m_NextEvent |= TCEVENT_PREP;
-		m_NextEvent = pPlayer->Exec(m_NextEvent, m_Field, m_CtrlPiece, m_NextPiece);
+		m_NextEvent = Exec(pPlayer, m_NextEvent);
 
 		//
 		// post exec
 		//
-		m_NextPiece.Randomize(m_Random);
+		SpawnPiece(m_NextPiece);
 
 		// rotate before falling
 		if (
@@ -374,7 +1023,7 @@ protected:
 			// coudn't place, i.e. gameover
 			m_NextEvent |= TCEVENT_GAME_OVER;
 			m_Field.SetPiece(m_CtrlPiece);
-			m_CtrlPiece.Invalidate();
+			m_CtrlPiece.Invalidate(m_Field.GetSize());
 			pPlayer->EndGame(m_Score);
 
 			return SEQ_GAME_OVER;
@@ -411,14 +1060,16 @@ protected:
 		// exec
 		//
 		m_NextEvent &= TCEVENT_MASK_PRE;
+		TCEVENT	EventPre = m_NextEvent;
 		m_NextEvent |= TCEVENT_FALL;
-		m_NextEvent = pPlayer->Exec(m_NextEvent, m_Field, m_CtrlPiece, m_NextPiece);
+		m_NextEvent = Exec(pPlayer, m_NextEvent);
 
 		//
 		// post exec
 		//
 		bool	bRotated = false;
 		bool	bMoved = false;
+		bool	bFell = false;
 
 		// rotate while falling
 		if (
@@ -489,6 +1140,7 @@ protected:
 				m_CtrlPiece = m_CtrlPiece.MoveY(-1);
 				m_HoverFrame = 0;
 				m_LandFrame = 0;
+				bFell = true;
 			}
 			if (m_Field.IsSetPiece(m_CtrlPiece.MoveY(-1))) {
 				if (m_LandFrame == 0) {
@@ -504,16 +1156,25 @@ protected:
 		if (m_NextEvent & TCEVENT_LAND) {
 			// piece fixed
 			m_Field.SetPiece(m_CtrlPiece);
-			m_CtrlPiece.Invalidate();
+			m_LinesMask = m_Field.GetLinesMask(m_CtrlPiece);	// 揃ったラインは、固まったピースがかかる段にしかない
+			m_CtrlPiece.Invalidate(m_Field.GetSize());
 		}
 
+		// 次のフレームでプレイヤに渡すものが何も変わらなければ、しばらくは係数が進むだけのフレームが続く
+		m_bQuiet =
+			!bRotated &&
+			!bMoved &&
+			!bFell &&
+			!(m_NextEvent & TCEVENT_LAND) &&
+			((m_NextEvent & TCEVENT_MASK_PRE) == EventPre);
+
 		return (m_NextEvent & TCEVENT_LAND) ? SEQ_CHECK : SEQ_FALL;
 
 	} // end of TCPLAYFIELD::Tick_Fall
 
 	TCSEQ	Tick_Check(TCPLAYER *pPlayer, TCEVENT &evt)
 	{
-		if (m_Field.CheckLines() > 0) {
+		if (m_LinesMask) {
 			return SEQ_LINE_OUT;
 		}
 
@@ -527,8 +1188,9 @@ protected:
 
 	TCSEQ	Tick_LineOut(TCPLAYER *pPlayer, TCEVENT &evt)
 	{
-		m_Score.AddLines(m_Field.CheckLines());
-		m_Field.RemoveLines();
+		m_Score.AddLines(static_cast<ssize_t>(TCBIT::Count(m_LinesMask)));
+		m_Field.RemoveLines(m_LinesMask);
+		m_LinesMask = 0;
 		{
 			size_t	SpotCount = m_Field.CountSpots();
 			m_Score.AddSpots(m_SpotCount, SpotCount);
@@ -0,0 +1,306 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCPLAYFIELDBATCH_H
+#define TCPLAYFIELDBATCH_H
+//! @file
+
+#include <vector>
+#include "tctype.h"
+#include "tcbit.h"
+#include "tcplayer.h"
+#include "tcplayfield.h"
+
+//----------------------------------------------------------------------------
+/*!
+	1 にすると、TCPLAYFIELDBATCH が SSE2 命令で４レーンずつまとめて係数を進めます。
+	0 にすると、どの CPU でも動作する汎用の実装（１レーンずつ）を使用します。
+	SSE2 に対応していないコンパイラ・CPU では、常に汎用の実装を使用します。
+*/
+#ifndef TCPLAYFIELDBATCH_SSE2
+#define TCPLAYFIELDBATCH_SSE2	1
+#endif
+
+#if TCPLAYFIELDBATCH_SSE2 && (defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__))
+#define TCPLAYFIELDBATCH_USE_SSE2	1
+#include <emmintrin.h>
+#else
+#define TCPLAYFIELDBATCH_USE_SSE2	0
+#endif
+
+/*!
+	多数のプレイフィールドを、１フレームずつ揃えて進行させるクラスです。
+	ピースが落下中で、次に変化が起こるまで重力と接地の係数が進むだけのプレイフィールド（TCPLAYFIELD::CountSkippableFrames を参照）は、
+	係数を構造体の配列ではなく配列の構造体（レーン）として持ち、全レーンをまとめて進めます。
+	プレイヤを呼ぶ・衝突を判定する必要のあるレーンだけが、TCPLAYFIELD::Tick で１フレーム進行します。
+	結果は、それぞれのプレイフィールドを１フレームずつ Tick で進行させたときと同じになります。
+	プレイフィールドとプレイヤは登録元が持ち、バッチは参照するだけです。
+*/
+class TCPLAYFIELDBATCH
+{
+	//
+	// assign
+	//
+private:
+	static const size_t		LANE_WIDTH = 4;				//!< まとめて進めるレーン数（レーン数はこの倍数に切り上げる）
+	static const uint32_t	SKIP_MAX = 0x7fffffff;		//!< 一度に係数だけで進めるフレーム数の上限（符号付きの比較で扱える範囲）
+	static const uint32_t	HOVER_MAX = 10;				//!< 重力の係数がこの値に届くと、ピースが落下する
+
+	//
+	// variable
+	//
+private:
+	std::vector<TCPLAYFIELD*>	m_PlayFields;	//!< 登録順のプレイフィールド
+	std::vector<TCPLAYER*>		m_Players;		//!< 登録順のプレイヤ
+	std::vector<uint32_t>		m_Skip;			//!< 係数だけで進めてよい残りフレーム数（0 ならそのフレームは Tick で進行させる）
+	std::vector<uint32_t>		m_Hover;		//!< 重力の係数（m_Skip が 0 でない間のみ有効）
+	std::vector<uint32_t>		m_Land;			//!< 接地の係数（m_Skip が 0 でない間のみ有効）
+	std::vector<uint32_t>		m_Gravity;		//!< 重力係数
+	std::vector<uint32_t>		m_Pending;		//!< 係数だけで進めて、まだプレイフィールドに書き戻していないフレーム数
+	std::vector<uint32_t>		m_Live;			//!< プレイ中のレーンなら FFFFFFFFh、そうでなければ 0
+	size_t						m_PlayingCount;	//!< プレイ中のレーン数
+
+	//
+	// method
+	//
+private:
+	TCPLAYFIELDBATCH(const TCPLAYFIELDBATCH &);
+	TCPLAYFIELDBATCH	&operator=(const TCPLAYFIELDBATCH &);
+
+public:
+	TCPLAYFIELDBATCH()
+		: m_PlayFields(),
+		m_Players(),
+		m_Skip(),
+		m_Hover(),
+		m_Land(),
+		m_Gravity(),
+		m_Pending(),
+		m_Live(),
+		m_PlayingCount(0)
+	{
+	} // end of TCPLAYFIELDBATCH::ctor
+
+	/*!
+		プレイフィールドとプレイヤの組を、レーンとして登録します。
+		@param[in] pPlayField プレイフィールド
+		@param[in] pPlayer プレイヤ入力のインスタンス
+	*/
+	void	Add(TCPLAYFIELD *pPlayField, TCPLAYER *pPlayer)
+	{
+		TCASSERT(pPlayField != NULL, "fatal.");
+		TCASSERT(pPlayer != NULL, "fatal.");
+
+		m_PlayFields.push_back(pPlayField);
+		m_Players.push_back(pPlayer);
+
+		// 端数のレーンは、プレイ中にならない空きレーンとして確保しておく
+		size_t	LaneCount = (m_PlayFields.size() + LANE_WIDTH - 1) / LANE_WIDTH * LANE_WIDTH;
+		m_Skip.resize(LaneCount, 0);
+		m_Hover.resize(LaneCount, 0);
+		m_Land.resize(LaneCount, 0);
+		m_Gravity.resize(LaneCount, 0);
+		m_Pending.resize(LaneCount, 0);
+		m_Live.resize(LaneCount, 0);
+		Load(m_PlayFields.size() - 1);
+
+	} // end of TCPLAYFIELDBATCH::Add
+
+	/*!
+		登録されているレーン数を返します。
+		@return レーン数
+	*/
+	size_t	GetCount() const
+	{
+		return m_PlayFields.size();
+
+	} // end of TCPLAYFIELDBATCH::GetCount
+
+	/*!
+		プレイフィールドを外から進行させた（StartGame など）後に呼び、全レーンの状態を読み込み直します。
+	*/
+	void	Reset()
+	{
+		for (size_t idx = 0; idx < m_PlayFields.size(); idx++) {
+			Load(idx);
+		}
+
+	} // end of TCPLAYFIELDBATCH::Reset
+
+	/*!
+		いずれかのレーンがプレイ中かどうかを返します。
+		@retval true プレイ中のものがある
+		@retval false すべて終わった
+	*/
+	bool	IsPlaying() const
+	{
+		return m_PlayingCount > 0;
+
+	} // end of TCPLAYFIELDBATCH::IsPlaying
+
+	/*!
+		プレイ中の全レーンを、１フレームだけ進行させます。
+	*/
+	void	Tick()
+	{
+		for (size_t lane = 0; lane < m_Skip.size(); lane += LANE_WIDTH) {
+			uint32_t	bitmap = Tick_Lanes(lane);
+			for (; bitmap != 0; bitmap &= bitmap - 1) {
+				Tick_Lane(lane + TCBIT::FindLowest(bitmap));
+			}
+		}
+
+	} // end of TCPLAYFIELDBATCH::Tick
+
+	/*!
+		係数だけで進めたフレームを、すべてのプレイフィールドに書き戻します。
+		プレイフィールドの状態（ハッシュ値など）を参照する前に呼ばなければなりません。
+	*/
+	void	Flush()
+	{
+		for (size_t idx = 0; idx < m_PlayFields.size(); idx++) {
+			Flush(idx);
+		}
+
+	} // end of TCPLAYFIELDBATCH::Flush
+
+private:
+	/*!
+		４レーン分の係数を、係数だけで進めてよいレーンについて１フレーム進めます。
+		Tick_Fall で、落下も固まりもしないフレームに起こることだけを行います。
+		@param[in] lane 先頭のレーン（LANE_WIDTH の倍数）
+		@return Tick で進行させなければならないレーンのビットマップ（lane からの相対位置）
+	*/
+	uint32_t	Tick_Lanes(size_t lane)
+	{
+#if TCPLAYFIELDBATCH_USE_SSE2
+		__m128i	Skip = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Skip[lane]));
+		__m128i	Hover = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Hover[lane]));
+		__m128i	Land = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Land[lane]));
+		__m128i	Gravity = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Gravity[lane]));
+		__m128i	Pending = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Pending[lane]));
+		__m128i	Live = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&m_Live[lane]));
+		__m128i	Zero = _mm_setzero_si128();
+
+		// 係数だけで進めるレーンは FFFFFFFFh（= -1）
+		__m128i	Quiet = _mm_cmpgt_epi32(Skip, Zero);
+
+		// 重力の係数を進め、接地しているか、重力の係数が届いたら（落下できないとき）接地の係数を進める
+		Hover = _mm_add_epi32(Hover, _mm_and_si128(Gravity, Quiet));
+		__m128i	Landing = _mm_or_si128(
+			_mm_cmpgt_epi32(Land, Zero),
+			_mm_cmpgt_epi32(Hover, _mm_set1_epi32(HOVER_MAX - 1))
+		);
+		Land = _mm_sub_epi32(Land, _mm_and_si128(Landing, Quiet));
+		Skip = _mm_add_epi32(Skip, Quiet);
+		Pending = _mm_sub_epi32(Pending, Quiet);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&m_Skip[lane]), Skip);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&m_Hover[lane]), Hover);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&m_Land[lane]), Land);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&m_Pending[lane]), Pending);
+
+		return static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(Quiet, Live))));
+#else
+		uint32_t	bitmap = 0;
+		for (size_t ii = 0; ii < LANE_WIDTH; ii++) {
+			size_t	idx = lane + ii;
+			if (m_Skip[idx] == 0) {
+				bitmap |= (m_Live[idx] != 0) ? TCBIT::Get(ii) : 0;
+				continue;
+			}
+			m_Hover[idx] += m_Gravity[idx];
+			if ((m_Land[idx] > 0) || (m_Hover[idx] >= HOVER_MAX)) {
+				m_Land[idx]++;
+			}
+			m_Skip[idx]--;
+			m_Pending[idx]++;
+		}
+		return bitmap;
+#endif
+
+	} // end of TCPLAYFIELDBATCH::Tick_Lanes
+
+	/*!
+		レーンを Tick で１フレーム進行させ、次に係数だけで進めてよいフレーム数を読み込みます。
+		@param[in] idx レーン
+	*/
+	void	Tick_Lane(size_t idx)
+	{
+		Flush(idx);
+		m_PlayFields[idx]->Tick(m_Players[idx]);
+		Load(idx);
+
+	} // end of TCPLAYFIELDBATCH::Tick_Lane
+
+	/*!
+		プレイフィールドの状態を、レーンに読み込みます。
+		@param[in] idx レーン
+	*/
+	void	Load(size_t idx)
+	{
+		const TCPLAYFIELD	*pPlayField = m_PlayFields[idx];
+
+		bool	bLive = pPlayField->IsPlaying();
+		if (bLive && (m_Live[idx] == 0)) {
+			m_PlayingCount++;
+		} else if (!bLive && (m_Live[idx] != 0)) {
+			m_PlayingCount--;
+		}
+		m_Live[idx] = bLive ? 0xffffffff : 0;
+
+		m_Skip[idx] = bLive ? static_cast<uint32_t>(min(pPlayField->CountSkippableFrames(m_Players[idx]), SKIP_MAX)) : 0;
+		m_Pending[idx] = 0;
+		if (m_Skip[idx] > 0) {
+			size_t	HoverFrame = 0;
+			size_t	LandFrame = 0;
+			pPlayField->GetFallFrames(HoverFrame, LandFrame);
+			m_Hover[idx] = static_cast<uint32_t>(HoverFrame);
+			m_Land[idx] = static_cast<uint32_t>(LandFrame);
+			m_Gravity[idx] = static_cast<uint32_t>(pPlayField->GetField().GetGravity());
+		}
+
+	} // end of TCPLAYFIELDBATCH::Load
+
+	/*!
+		レーンで進めた係数を、プレイフィールドに書き戻します。
+		@param[in] idx レーン
+	*/
+	void	Flush(size_t idx)
+	{
+		if (m_Pending[idx] == 0) {
+			return;
+		}
+		m_PlayFields[idx]->SetFallFrames(m_Hover[idx], m_Land[idx], m_Pending[idx]);
+		m_Pending[idx] = 0;
+
+	} // end of TCPLAYFIELDBATCH::Flush
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCPLAYFIELDBATCH_H
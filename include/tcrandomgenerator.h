@@ -30,6 +30,7 @@
 
 #include <ctime>
 #include "tctype.h"
+#include "tchash.h"
 
 //----------------------------------------------------------------------------
 /*!
@@ -122,6 +123,18 @@ public:
 		return m_ValW;
 
 	} // end of TCRANDOMGENERATOR::Get
+
+	/*!
+		乱数ジェネレータの状態のハッシュ値を取得します。
+		同じハッシュ値のインスタンスは、（まず間違いなく）以降も同じ乱数列を生成します。
+		@return ハッシュ値
+	*/
+	uint64_t	GetHash() const
+	{
+		uint64_t	Hash = TCHASH::Mix((static_cast<uint64_t>(m_ValX) << 32) | m_ValY);
+		return TCHASH::Combine(Hash, (static_cast<uint64_t>(m_ValZ) << 32) | m_ValW);
+
+	} // end of TCRANDOMGENERATOR::GetHash
 };
 
 
@@ -0,0 +1,479 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCSPOOL_H
+#define TCSPOOL_H
+//! @file
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <strstream>
+#include <vector>
+#include "tctype.h"
+#include "tcstreamwriter_file.h"
+#include "tcstring.h"
+#include "tctournament.h"
+
+//----------------------------------------------------------------------------
+/*!
+	複数の tetcon プロセス（別のマシンでもよい）で、１つのトーナメントを分担して実行するためのスプールフォルダです。
+	トーナメントを１パラメタセット・１シードごとのユニットに分け、ユニットファイルとして todo フォルダに置きます。
+	ワーカは todo のユニットファイルを work フォルダへリネームして取得し、実行を終えると結果ファイルを done フォルダへ置きます。
+	リネームはアトミックなので、同じユニットを取得できるワーカは１つだけです。
+	done の結果ファイルを連結すると、TCTOURNAMENT で一度に実行したときと同じ行（順序は除く）の結果になります。
+	プレイヤ（DLL）のパス名は、すべてのワーカから同じ名前で参照できなければなりません。
+
+	<spool>\todo\<unit>.job … 未実行のユニット
+	<spool>\work\<unit>.job … 実行中のユニット（<unit>.log は実行中の結果）
+	<spool>\done\<unit>.log … 実行を終えたユニットの結果
+	<spool>\failed\<unit>.job … 読み込めなかった（実行できなかった）ユニット
+*/
+class TCSPOOL
+{
+	//
+	// assign
+	//
+public:
+	/*!
+		１ユニット分のジョブ指定です。
+		ユニットファイルには、１行に１つずつ KEY=VALUE の形式で書き出します（PARAMS は TCSTRINGLIST の書式なので、行単位で区切ります）。
+	*/
+	class UNIT
+	{
+	public:
+		std::string					m_Name;		//!< ユニット名（ファイル名から拡張子を除いたもの）
+		std::string					m_RuleOpt;	//!< パラメタセット（PARAMS）
+		std::string					m_Seeds;	//!< シード（SEEDS）
+		std::vector<std::string>	m_Players;	//!< プレイヤ（PLAYER、登録順）
+	};
+
+	//
+	// variable
+	//
+private:
+	std::string					m_Dir;			//!< スプールフォルダ
+	size_t						m_UnitCount;	//!< Work で実行したユニット数
+	size_t						m_FailedCount;	//!< Work で実行できずに failed へ移したユニット数
+	size_t						m_JobCount;		//!< Work で実行したジョブ数
+	size_t						m_FrameCount;	//!< Work で進行させたフレーム数
+	size_t						m_PieceCount;	//!< Work で落下させたピース数
+
+	//
+	// method
+	//
+public:
+	/*!
+		標準のコンストラクタです。
+		@param[in] Dir スプールフォルダ
+	*/
+	TCSPOOL(const std::string &Dir)
+		: m_Dir(Dir),
+		m_UnitCount(0),
+		m_FailedCount(0),
+		m_JobCount(0),
+		m_FrameCount(0),
+		m_PieceCount(0)
+	{
+		if ((m_Dir.size() > 0) && (strchr("/\\", m_Dir[m_Dir.size() - 1]) == NULL)) {
+			m_Dir.append("\\");
+		}
+
+	} // end of TCSPOOL::ctor
+
+	/*!
+		デストラクタです。
+	*/
+	virtual ~TCSPOOL()
+	{
+	} // end of TCSPOOL::dtor
+
+	/*!
+		スプールフォルダを作成し、パラメタセット × シードのユニットを登録します。
+		前のトーナメントと混ざらないように、スプールフォルダはまだ存在していてはいけません。
+		@param[in] RuleOpts パラメタセット（TCTOURNAMENT::AddParams と同じ）
+		@param[in] strSeeds シード（TCTOURNAMENT::AddSeeds と同じ）
+		@param[in] Players プレイヤ（DLL）
+		@retval true 成功
+		@retval false シードの書式が正しくないか、スプールフォルダを作成できなかった
+	*/
+	bool	Enqueue(const std::vector<const char*> &RuleOpts, const std::string &strSeeds, const std::vector<const char*> &Players)
+	{
+		std::vector<uint32_t>	Seeds;
+		if (!TCTOURNAMENT::ParseSeeds(strSeeds, Seeds)) {
+			return false;
+		}
+		if (!CreateDirectoryA(m_Dir.c_str(), NULL) ||
+			!CreateDirectoryA(GetPath("todo", "", "").c_str(), NULL) ||
+			!CreateDirectoryA(GetPath("work", "", "").c_str(), NULL) ||
+			!CreateDirectoryA(GetPath("done", "", "").c_str(), NULL) ||
+			!CreateDirectoryA(GetPath("failed", "", "").c_str(), NULL)) {
+			return false;
+		}
+
+		for (size_t pp = 0; pp < RuleOpts.size(); pp++) {
+			for (size_t ss = 0; ss < Seeds.size(); ss++) {
+				std::strstream	Value;
+				Value
+					<< std::setfill('0')
+					<< std::setw(4) << pp << "_"
+					<< std::setw(10) << Seeds[ss]
+					<< std::ends;
+				std::string	Name(Value.str());
+
+				// 書きかけのユニットを取得されないように、スプールフォルダ直下で書き終えてから todo へ移す
+				std::string	TempPath = GetPath("", Name, ".tmp");
+				{
+					TCSTREAMWRITER_FILE	Writer(TempPath);
+					Writer.Get()
+						<< "PARAMS=" << RuleOpts[pp] << std::endl
+						<< "SEEDS=" << Seeds[ss];
+					for (size_t ii = 0; ii < Players.size(); ii++) {
+						Writer.Get()
+							<< std::endl
+							<< "PLAYER=" << Players[ii];
+					}
+					Writer.Get()
+						<< std::ends;
+					if (!Writer.Submit()) {
+						return false;
+					}
+				}
+				if (!MoveFileA(TempPath.c_str(), GetPath("todo", Name, ".job").c_str())) {
+					return false;
+				}
+			}
+		}
+		return true;
+
+	} // end of TCSPOOL::Enqueue
+
+	/*!
+		未実行のユニットを１つ取得します。
+		todo から work へのリネームに成功したユニットだけが、このワーカのものになります。
+		読み込めなかったユニットは failed へ移し、次のユニットを取得します。
+		@param[out] Unit 取得したユニット
+		@retval true 取得した
+		@retval false 未実行のユニットがない
+	*/
+	bool	Claim(UNIT &Unit)
+	{
+		std::vector<std::string>	Names;
+		ListFiles(GetPath("todo", "*", ".job"), Names);
+		for (size_t ii = 0; ii < Names.size(); ii++) {
+			std::string	Name = Names[ii].substr(0, Names[ii].size() - strlen(".job"));
+			if (!MoveFileA(GetPath("todo", Name, ".job").c_str(), GetPath("work", Name, ".job").c_str())) {
+				// 他のワーカが先に取得した
+				continue;
+			}
+			if (Load(GetPath("work", Name, ".job"), Unit)) {
+				Unit.m_Name = Name;
+				DeleteFileA(GetPath("work", Name, ".log").c_str());
+				return true;
+			}
+			TCVERBOSE("unit invalid.");
+			Reject(Name);
+		}
+		return false;
+
+	} // end of TCSPOOL::Claim
+
+	/*!
+		取得したユニットの結果を出力するファイル名を返します（Complete で done へ移します）。
+		@param[in] Unit 取得したユニット
+		@return ファイル名
+	*/
+	std::string	GetResultPath(const UNIT &Unit) const
+	{
+		return GetPath("work", Unit.m_Name, ".log");
+
+	} // end of TCSPOOL::GetResultPath
+
+	/*!
+		取得したユニットの実行を終えたことを通知します。
+		結果ファイルを done へ移してから、ユニットファイルを削除します。
+		@param[in] Unit 取得したユニット
+		@retval true 成功
+		@retval false 結果ファイルを移せなかった
+	*/
+	bool	Complete(const UNIT &Unit)
+	{
+		if (!MoveFileA(GetResultPath(Unit).c_str(), GetPath("done", Unit.m_Name, ".log").c_str())) {
+			return false;
+		}
+		DeleteFileA(GetPath("work", Unit.m_Name, ".job").c_str());
+		return true;
+
+	} // end of TCSPOOL::Complete
+
+	/*!
+		取得したユニットを実行できないとき、failed へ移して、未実行・実行中のユニットから外します。
+		途中まで出力した結果ファイルは削除します。
+		@param[in] Name ユニット名
+	*/
+	void	Reject(const std::string &Name)
+	{
+		DeleteFileA(GetPath("work", Name, ".log").c_str());
+
+		// failed がない古いスプールフォルダのために作成しておく（すでにあれば失敗するが構わない）
+		CreateDirectoryA(GetPath("failed", "", "").c_str(), NULL);
+		if (!MoveFileA(GetPath("work", Name, ".job").c_str(), GetPath("failed", Name, ".job").c_str())) {
+			// 移せなくても、同じユニットを何度も取得しないように work からは外す
+			TCVERBOSE("unit not moved.");
+			DeleteFileA(GetPath("work", Name, ".job").c_str());
+		}
+		m_FailedCount++;
+
+	} // end of TCSPOOL::Reject
+
+	/*!
+		未実行のユニットがなくなるまで、ユニットを取得して TCTOURNAMENT で実行します。
+		実行できないユニットは failed へ移すので、ワーカが止まってもユニットが work に残ることはありません。
+		@param[in] ViewOpt 実行オプション（TCTOURNAMENT と同じ）
+		@return 実行したユニット数
+	*/
+	size_t	Work(const std::string &ViewOpt)
+	{
+		UNIT	Unit;
+		while (Claim(Unit)) {
+			std::cerr << "unit " << Unit.m_Name << std::endl;
+
+			TCTOURNAMENT	tour(ViewOpt, GetResultPath(Unit));
+			if (!tour.AddSeeds(Unit.m_Seeds)) {
+				TCVERBOSE("unit invalid.");
+				Reject(Unit.m_Name);
+				continue;
+			}
+			tour.AddParams(Unit.m_RuleOpt);
+			for (size_t ii = 0; ii < Unit.m_Players.size(); ii++) {
+				tour.AddPlayer(Unit.m_Players[ii].c_str());
+			}
+			tour.Run();
+
+			if (Complete(Unit)) {
+				m_UnitCount++;
+				m_JobCount += tour.GetJobCount();
+				m_FrameCount += tour.GetFrameCount();
+				m_PieceCount += tour.GetPieceCount();
+			}
+		}
+		return m_UnitCount;
+
+	} // end of TCSPOOL::Work
+
+	/*!
+		実行中のまま残ったユニット（ワーカが中断した）を、未実行に戻します。
+		実行中のワーカがいないときに使用します。
+		@return 未実行に戻したユニット数
+	*/
+	size_t	Requeue()
+	{
+		size_t	count = 0;
+		std::vector<std::string>	Names;
+		ListFiles(GetPath("work", "*", ".job"), Names);
+		for (size_t ii = 0; ii < Names.size(); ii++) {
+			std::string	Name = Names[ii].substr(0, Names[ii].size() - strlen(".job"));
+			DeleteFileA(GetPath("work", Name, ".log").c_str());
+			if (MoveFileA(GetPath("work", Name, ".job").c_str(), GetPath("todo", Name, ".job").c_str())) {
+				count++;
+			}
+		}
+		return count;
+
+	} // end of TCSPOOL::Requeue
+
+	/*!
+		実行を終えたユニットの結果を、ユニット名の順に連結して出力します。
+		@param[in] ReportDst 結果を出力するファイル名（<yymmdd>・<hhmmss> は日時に置き換える）
+		@param[out] DoneCount 連結したユニット数
+		@param[out] PendingCount 未実行・実行中のユニット数
+		@param[out] FailedCount 実行できずに failed へ移したユニット数（結果は連結しない）
+		@retval true 成功
+		@retval false 出力できなかった
+	*/
+	bool	Merge(const std::string &ReportDst, size_t &DoneCount, size_t &PendingCount, size_t &FailedCount) const
+	{
+		std::vector<std::string>	Names;
+		ListFiles(GetPath("todo", "*", ".job"), Names);
+		ListFiles(GetPath("work", "*", ".job"), Names);
+		PendingCount = Names.size();
+
+		Names.clear();
+		ListFiles(GetPath("failed", "*", ".job"), Names);
+		FailedCount = Names.size();
+
+		Names.clear();
+		ListFiles(GetPath("done", "*", ".log"), Names);
+		DoneCount = Names.size();
+
+		TCSTREAMWRITER_FILE	Writer(TCSTRING::Embed(ReportDst));
+		bool	bFirst = true;
+		for (size_t ii = 0; ii < Names.size(); ii++) {
+			std::ifstream	File(GetPath("done", "", Names[ii]).c_str());
+			std::string		Line;
+			while (std::getline(File, Line)) {
+				if (Line.empty()) {
+					continue;
+				}
+				if (!bFirst) {
+					Writer.Get() << std::endl;
+				}
+				Writer.Get() << Line;
+				bFirst = false;
+			}
+		}
+		Writer.Get()
+			<< std::ends;
+		return Writer.Submit();
+
+	} // end of TCSPOOL::Merge
+
+	/*!
+		Work で実行できずに failed へ移したユニット数を返します。
+		@return ユニット数
+	*/
+	size_t	GetFailedCount() const
+	{
+		return m_FailedCount;
+
+	} // end of TCSPOOL::GetFailedCount
+
+	/*!
+		Work で実行したジョブ数を返します。
+		@return ジョブ数
+	*/
+	size_t	GetJobCount() const
+	{
+		return m_JobCount;
+
+	} // end of TCSPOOL::GetJobCount
+
+	/*!
+		Work で進行させたフレーム数の合計を返します。
+		@return フレーム数
+	*/
+	size_t	GetFrameCount() const
+	{
+		return m_FrameCount;
+
+	} // end of TCSPOOL::GetFrameCount
+
+	/*!
+		Work で落下させたピース数の合計を返します。
+		@return ピース数
+	*/
+	size_t	GetPieceCount() const
+	{
+		return m_PieceCount;
+
+	} // end of TCSPOOL::GetPieceCount
+
+private:
+	/*!
+		スプールフォルダ内のパス名を返します。
+		@param[in] Sub サブフォルダ名（空ならスプールフォルダ直下）
+		@param[in] Name ファイル名（拡張子を除く）
+		@param[in] Ext 拡張子
+		@return パス名
+	*/
+	std::string	GetPath(const std::string &Sub, const std::string &Name, const std::string &Ext) const
+	{
+		std::string	rv(m_Dir);
+		if (Sub.size() > 0) {
+			rv.append(Sub);
+			rv.append("\\");
+		}
+		rv.append(Name);
+		rv.append(Ext);
+		return rv;
+
+	} // end of TCSPOOL::GetPath
+
+	/*!
+		ワイルドカードに一致するファイル名を、名前の順に追加します。
+		@param[in] Pattern ワイルドカードを含むパス名
+		@param[in/out] Names ファイル名（フォルダ名を除く）の追加先
+	*/
+	static void	ListFiles(const std::string &Pattern, std::vector<std::string> &Names)
+	{
+		std::vector<std::string>	Found;
+		WIN32_FIND_DATAA	Data;
+		HANDLE	hFind = FindFirstFileA(Pattern.c_str(), &Data);
+		if (hFind != INVALID_HANDLE_VALUE) {
+			do {
+				if ((Data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0) {
+					Found.push_back(std::string(Data.cFileName));
+				}
+			} while (FindNextFileA(hFind, &Data));
+			FindClose(hFind);
+		}
+		std::sort(Found.begin(), Found.end());
+		Names.insert(Names.end(), Found.begin(), Found.end());
+
+	} // end of TCSPOOL::ListFiles
+
+	/*!
+		ユニットファイルを読み込みます。
+		@param[in] Path ユニットファイルのパス名
+		@param[out] Unit ユニット
+		@retval true 成功
+		@retval false PARAMS・SEEDS・PLAYER のいずれかがない
+	*/
+	static bool	Load(const std::string &Path, UNIT &Unit)
+	{
+		Unit.m_RuleOpt.erase();
+		Unit.m_Seeds.erase();
+		Unit.m_Players.clear();
+
+		std::ifstream	File(Path.c_str());
+		std::string		Line;
+		while (std::getline(File, Line)) {
+			std::string::size_type	pos = Line.find('=');
+			if (pos == Line.npos) {
+				continue;
+			}
+			std::string	Key = Line.substr(0, pos);
+			std::string	Value = Line.substr(pos + 1);
+			if (Key == "PARAMS") {
+				Unit.m_RuleOpt = Value;
+			} else if (Key == "SEEDS") {
+				Unit.m_Seeds = Value;
+			} else if (Key == "PLAYER") {
+				Unit.m_Players.push_back(Value);
+			}
+		}
+		return (Unit.m_RuleOpt.size() > 0) && (Unit.m_Seeds.size() > 0) && (Unit.m_Players.size() > 0);
+
+	} // end of TCSPOOL::Load
+
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCSPOOL_H
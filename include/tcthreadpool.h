@@ -0,0 +1,358 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCTHREADPOOL_H
+#define TCTHREADPOOL_H
+//! @file
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+#include <vector>
+#include "tctype.h"
+#include "tcdebug.h"
+
+//----------------------------------------------------------------------------
+/*!
+	タスクを複数のスレッドで並行して実行するためのスレッドプールです。
+	スレッドはコンストラクタで生成し、Run を呼ぶたびに使い回します。
+	Run に渡したタスクの配列は、ワーカスレッドの数に分割して各スレッドに割り当てます。
+	各スレッドは自分の割り当てを先頭から順に実行し、なくなったら、他のスレッドの割り当ての末尾から横取りして実行します（ワークスティーリング）。
+	実行時間がタスクごとに大きく異なっても、すべてのスレッドが最後まで働きます。
+	どのタスクがどのスレッドで実行されるかは決まらないので、タスクの結果は各タスクの中に保持しておき、
+	Run から戻った後に配列の順に集めるか、LISTENER で終わった順に受け取ってください。
+*/
+class TCTHREADPOOL
+{
+	//
+	// assign
+	//
+public:
+	/*!
+		スレッドプールで実行するタスクのインタフェースです。
+	*/
+	class TASK
+	{
+	public:
+		/*!
+			デストラクタです。
+		*/
+		virtual ~TASK() {}
+
+		/*!
+			タスクを実行します。
+			いずれかのワーカスレッドから呼ばれます。
+		*/
+		virtual void	Exec() = 0;
+	};
+
+	/*!
+		タスクが終わるたびに通知を受け取るためのインタフェースです。
+	*/
+	class LISTENER
+	{
+	public:
+		/*!
+			デストラクタです。
+		*/
+		virtual ~LISTENER() {}
+
+		/*!
+			タスクが終わったことを通知します。
+			いずれかのワーカスレッドから呼ばれますが、呼び出しは直列化されているので、同時に呼ばれることはありません。
+			@param[in/out] pTask 終わったタスク
+		*/
+		virtual void	OnDone(TASK *pTask) = 0;
+	};
+
+private:
+	/*!
+		ワーカスレッドごとの、タスクの割り当てです。
+		割り当てられたタスクの添え字の範囲 [m_Head, m_Tail) を持ち、
+		持ち主は先頭から、他のスレッドは末尾から取り出します。
+	*/
+	class WORKER
+	{
+	public:
+		TCTHREADPOOL			*m_pPool;	//!< 所属するスレッドプール
+		size_t					m_Index;	//!< ワーカスレッドの番号
+		CRITICAL_SECTION		m_Lock;		//!< m_Head・m_Tail を保護するロック
+		size_t					m_Head;		//!< 次に持ち主が取り出すタスクの添え字
+		size_t					m_Tail;		//!< 割り当ての終端（他のスレッドは m_Tail - 1 を取り出す）
+
+	public:
+		WORKER(TCTHREADPOOL *pPool, size_t Index)
+			: m_pPool(pPool),
+			m_Index(Index),
+			m_Head(0),
+			m_Tail(0)
+		{
+			InitializeCriticalSection(&m_Lock);
+
+		} // end of TCTHREADPOOL::WORKER::ctor
+
+		~WORKER()
+		{
+			DeleteCriticalSection(&m_Lock);
+
+		} // end of TCTHREADPOOL::WORKER::dtor
+
+		/*!
+			割り当てから、タスクを１つ取り出します。
+			@param[in] bSteal 末尾から取り出す（他のスレッドが横取りする）かどうか
+			@param[out] idx 取り出したタスクの添え字
+			@retval true 取り出した
+			@retval false 割り当てが空だった
+		*/
+		bool	Pop(bool bSteal, size_t &idx)
+		{
+			bool	rv = false;
+			EnterCriticalSection(&m_Lock);
+			if (m_Head < m_Tail) {
+				idx = bSteal ? --m_Tail : m_Head++;
+				rv = true;
+			}
+			LeaveCriticalSection(&m_Lock);
+			return rv;
+
+		} // end of TCTHREADPOOL::WORKER::Pop
+	};
+
+	//
+	// variable
+	//
+private:
+	std::vector<HANDLE>		m_Threads;		//!< ワーカスレッドのハンドル
+	std::vector<WORKER*>	m_Workers;		//!< ワーカスレッドごとのタスクの割り当て（m_Threads と同じ順）
+	HANDLE					m_hWake;		//!< ワーカスレッドを起こすためのセマフォ
+	HANDLE					m_hDone;		//!< すべてのワーカスレッドが手を空けたことを通知するイベント
+	CRITICAL_SECTION		m_ListenerLock;	//!< LISTENER の呼び出しを直列化するロック
+	std::vector<TASK*>		*m_pTasks;		//!< 実行中のタスク
+	LISTENER				*m_pListener;	//!< 実行中のタスクの終了を通知する先（NULL なら通知しない）
+	volatile LONG			m_Active;		//!< タスクを取り出しているワーカスレッドの数
+	volatile bool			m_bQuit;		//!< ワーカスレッドを終了させるかどうか
+
+	//
+	// method
+	//
+public:
+	/*!
+		標準のコンストラクタです。
+		ワーカスレッドを生成して、タスクを待たせておきます。
+		@param[in] ThreadCount ワーカスレッドの数（0 指定時は論理プロセッサ数）
+	*/
+	TCTHREADPOOL(size_t ThreadCount = 0)
+		: m_Threads(),
+		m_Workers(),
+		m_hWake(NULL),
+		m_hDone(NULL),
+		m_pTasks(NULL),
+		m_pListener(NULL),
+		m_Active(0),
+		m_bQuit(false)
+	{
+		if (ThreadCount == 0) {
+			ThreadCount = GetProcessorCount();
+		}
+
+		InitializeCriticalSection(&m_ListenerLock);
+		m_hWake = CreateSemaphore(NULL, 0, static_cast<LONG>(ThreadCount), NULL);
+		TCASSERT(m_hWake != NULL, "CreateSemaphore failed.");
+		m_hDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+		TCASSERT(m_hDone != NULL, "CreateEvent failed.");
+
+		for (size_t ii = 0; ii < ThreadCount; ii++) {
+			WORKER	*pWorker = new WORKER(this, m_Threads.size());
+			HANDLE	hThread = reinterpret_cast<HANDLE>(_beginthreadex(NULL, 0, ThreadProc, pWorker, 0, NULL));
+			TCASSERT(hThread != NULL, "_beginthreadex failed.");
+			if (hThread) {
+				m_Threads.push_back(hThread);
+				m_Workers.push_back(pWorker);
+			} else {
+				delete pWorker;
+			}
+		}
+
+	} // end of TCTHREADPOOL::ctor
+
+	/*!
+		デストラクタです。
+		すべてのワーカスレッドを終了させてから戻ります。
+	*/
+	~TCTHREADPOOL()
+	{
+		m_bQuit = true;
+		if (m_Threads.size() > 0) {
+			ReleaseSemaphore(m_hWake, static_cast<LONG>(m_Threads.size()), NULL);
+		}
+		for (size_t ii = 0; ii < m_Threads.size(); ii++) {
+			WaitForSingleObject(m_Threads[ii], INFINITE);
+			CloseHandle(m_Threads[ii]);
+		}
+		m_Threads.clear();
+		for (size_t ii = 0; ii < m_Workers.size(); ii++) {
+			delete m_Workers[ii];
+			m_Workers[ii] = NULL;
+		}
+		m_Workers.clear();
+
+		CloseHandle(m_hDone);
+		CloseHandle(m_hWake);
+		DeleteCriticalSection(&m_ListenerLock);
+
+	} // end of TCTHREADPOOL::dtor
+
+	/*!
+		ワーカスレッドの数を返します。
+		@return ワーカスレッドの数
+	*/
+	size_t	GetThreadCount() const
+	{
+		return m_Threads.size();
+
+	} // end of TCTHREADPOOL::GetThreadCount
+
+	/*!
+		指定されたタスクをすべて実行します。
+		タスクはワーカスレッドで並行して実行され、すべてのタスクが終わるまで戻りません。
+		ワーカスレッドを生成できなかったときは、呼び出し元のスレッドで順に実行します。
+		@param[in/out] Tasks 実行するタスクの配列
+		@param[in/out] pListener タスクが終わるたびに通知を受け取るインスタンス（NULL なら通知しない）
+	*/
+	void	Run(std::vector<TASK*> &Tasks, LISTENER *pListener = NULL)
+	{
+		if (Tasks.size() == 0) {
+			return;
+		}
+		if (m_Threads.size() == 0) {
+			for (size_t ii = 0; ii < Tasks.size(); ii++) {
+				Tasks[ii]->Exec();
+				if (pListener) {
+					pListener->OnDone(Tasks[ii]);
+				}
+			}
+			return;
+		}
+
+		// 配列を連続した範囲に分けて割り当てる（隣り合うタスクは同じスレッドで続けて実行される）
+		for (size_t ii = 0; ii < m_Workers.size(); ii++) {
+			m_Workers[ii]->m_Head = Tasks.size() * ii / m_Workers.size();
+			m_Workers[ii]->m_Tail = Tasks.size() * (ii + 1) / m_Workers.size();
+		}
+
+		m_pTasks = &Tasks;
+		m_pListener = pListener;
+		m_Active = static_cast<LONG>(m_Threads.size());
+		ReleaseSemaphore(m_hWake, static_cast<LONG>(m_Threads.size()), NULL);
+		WaitForSingleObject(m_hDone, INFINITE);
+		m_pTasks = NULL;
+		m_pListener = NULL;
+
+	} // end of TCTHREADPOOL::Run
+
+	/*!
+		論理プロセッサ数を返します。
+		@return 論理プロセッサ数（1～）
+	*/
+	static size_t	GetProcessorCount()
+	{
+		SYSTEM_INFO	Info;
+		GetSystemInfo(&Info);
+		return max(Info.dwNumberOfProcessors, 1);
+
+	} // end of TCTHREADPOOL::GetProcessorCount
+
+private:
+	/*!
+		ワーカスレッドの本体です。
+		起こされるたびに、自分の割り当て、次に他のスレッドの割り当てから、タスクがなくなるまで取り出して実行します。
+		Run の間はタスクが増えないので、すべての割り当てが空になったら、そのスレッドの仕事は終わりです。
+		セマフォはワーカスレッドの数だけ解放するので、どのスレッドが何回起こされても、
+		m_Active がゼロになった時点ですべてのタスクが終わっています。
+		@param[in] pArg ワーカスレッドの割り当て
+		@return 終了コード
+	*/
+	static unsigned __stdcall	ThreadProc(void *pArg)
+	{
+		WORKER			*pWorker = static_cast<WORKER*>(pArg);
+		TCTHREADPOOL	*pPool = pWorker->m_pPool;
+
+		for (;;) {
+			WaitForSingleObject(pPool->m_hWake, INFINITE);
+			if (pPool->m_bQuit) {
+				break;
+			}
+
+			std::vector<TASK*>	&Tasks = *pPool->m_pTasks;
+			size_t				idx = 0;
+			while (pPool->PopTask(pWorker->m_Index, idx)) {
+				try {
+					Tasks[idx]->Exec();
+				} catch (...) {
+					TCVERBOSE("task threw an exception.");
+				}
+				if (pPool->m_pListener) {
+					EnterCriticalSection(&pPool->m_ListenerLock);
+					pPool->m_pListener->OnDone(Tasks[idx]);
+					LeaveCriticalSection(&pPool->m_ListenerLock);
+				}
+			}
+
+			if (InterlockedDecrement(&pPool->m_Active) == 0) {
+				SetEvent(pPool->m_hDone);
+			}
+		}
+		return 0;
+
+	} // end of TCTHREADPOOL::ThreadProc
+
+	/*!
+		次に実行するタスクを、自分の割り当ての先頭から取り出します。
+		自分の割り当てが空なら、隣のスレッドから順に、割り当ての末尾から横取りします。
+		@param[in] Index ワーカスレッドの番号
+		@param[out] idx 取り出したタスクの添え字
+		@retval true 取り出した
+		@retval false すべての割り当てが空だった
+	*/
+	bool	PopTask(size_t Index, size_t &idx)
+	{
+		if (m_Workers[Index]->Pop(false, idx)) {
+			return true;
+		}
+		for (size_t ii = 1; ii < m_Workers.size(); ii++) {
+			if (m_Workers[(Index + ii) % m_Workers.size()]->Pop(true, idx)) {
+				return true;
+			}
+		}
+		return false;
+
+	} // end of TCTHREADPOOL::PopTask
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCTHREADPOOL_H
@@ -0,0 +1,518 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCTOURNAMENT_H
+#define TCTOURNAMENT_H
+//! @file
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <strstream>
+#include <vector>
+#include "tctype.h"
+#include "tcgamecontrol.h"
+#include "tcpiecesequence.h"
+#include "tcplayerdll.h"
+#include "tcplayfield.h"
+#include "tcrandomgenerator.h"
+#include "tcstring.h"
+#include "tcstringlist.h"
+#include "tcthreadpool.h"
+
+//----------------------------------------------------------------------------
+/*!
+	複数のプレイヤ（DLL）を、複数のルール（パラメタセット）・シードの組み合わせで評価するトーナメントです。
+	プレイヤ × パラメタセット × シード × ラウンドの組み合わせをそれぞれ１つのジョブとし、すべてのジョブを一度にスレッドプールに渡します。
+	早くゲームオーバーになるジョブとそうでないジョブが混ざっても、空いたスレッドが他のスレッドのジョブを横取りして実行するので、最後まで偏りなく進みます。
+	結果はジョブが終わった順に１行ずつ出力するので、途中で打ち切っても、それまでの結果は残ります。
+	シード S のラウンド N は、RuleOpt に SEED=S を指定して TCGAMECONTROL で実行したときのラウンド N と同じピース列になります。
+*/
+class TCTOURNAMENT : private TCTHREADPOOL::LISTENER
+{
+	//
+	// assign
+	//
+public:
+	static const size_t		SEED_COUNT_MAX = 1000000;	//!< 登録できるシードの数の上限
+
+private:
+	static const DWORD		PROGRESS_INTERVAL = 1000;	//!< 進捗を表示する間隔（ms）
+	static const size_t		FAST_FORWARD_FRAME = 1000;	//!< 早送りで一度に進行させるフレーム数の上限
+
+	/*!
+		パラメタセット（ルール）ごとの設定です。
+		ワーカスレッドからは読み出すだけなので、必要な値はメインスレッドで取り出しておきます。
+	*/
+	class PARAMS
+	{
+	public:
+		std::string				m_RuleOpt;		//!< プレイヤに渡すルール
+		int8_t					m_Width;		//!< フィールドの幅
+		int8_t					m_Height;		//!< フィールドの高さ
+		size_t					m_Gravity;		//!< 重力係数
+		size_t					m_RoundCount;	//!< シードごとのラウンド数
+	};
+
+	/*!
+		１プレイヤ・１パラメタセット・１シード・１ラウンド分のゲームを実行するジョブです。
+		同時に生成しておくインスタンスを抑えるため、プレイフィールドとプレイヤのインスタンスは実行中だけ生成します。
+		プレイヤの DLL はメインスレッドで開いたままにしてあるので、ジョブで行うのはインスタンスの生成と破棄だけです。
+	*/
+	class JOBTASK : public TCTHREADPOOL::TASK
+	{
+		//
+		// variable
+		//
+	public:
+		const std::string		*m_pLibName;	//!< プレイヤ DLL のファイル名
+		const TCPLAYERDLL		*m_pOpenedDll;	//!< メインスレッドで開いたプレイヤ（開けなかったときは Get が NULL を返す）
+		size_t					m_PlayerIdx;	//!< プレイヤの登録順（0～）
+		size_t					m_InstanceId;	//!< プレイヤのインスタンス ID
+		const PARAMS			*m_pParams;		//!< パラメタセット
+		const std::string		*m_pHostname;	//!< 実行中のホスト名
+		uint32_t				m_Seed;			//!< シード（1～）
+		size_t					m_Round;		//!< ラウンド数（1～）
+		bool					m_bFastForward;	//!< 変化のないフレームを早送りするかどうか
+		std::string				m_Result;		//!< 結果（KEY=VALUE 形式）
+		bool					m_bFailed;		//!< プレイヤを開けず、ゲームを実行できなかったかどうか
+		size_t					m_FrameCount;	//!< 進行させたフレーム数
+		size_t					m_PieceCount;	//!< 落下させたピース数
+
+		//
+		// method
+		//
+	public:
+		JOBTASK(const std::string *pLibName, const TCPLAYERDLL *pOpenedDll, size_t PlayerIdx, size_t InstanceId, const PARAMS *pParams, const std::string *pHostname, uint32_t Seed, size_t Round, bool bFastForward)
+			: m_pLibName(pLibName),
+			m_pOpenedDll(pOpenedDll),
+			m_PlayerIdx(PlayerIdx),
+			m_InstanceId(InstanceId),
+			m_pParams(pParams),
+			m_pHostname(pHostname),
+			m_Seed(Seed),
+			m_Round(Round),
+			m_bFastForward(bFastForward),
+			m_Result(),
+			m_bFailed(false),
+			m_FrameCount(0),
+			m_PieceCount(0)
+		{
+			TCASSERT(m_pLibName != NULL, "fatal.");
+			TCASSERT(m_pOpenedDll != NULL, "fatal.");
+			TCASSERT(m_pParams != NULL, "fatal.");
+			TCASSERT(m_pHostname != NULL, "fatal.");
+
+		} // end of TCTOURNAMENT::JOBTASK::ctor
+
+		void	Exec()
+		{
+			const PARAMS	&Params = *m_pParams;
+
+			TCPLAYFIELD	PlayField(Params.m_Width, Params.m_Height, Params.m_Gravity);
+			TCPLAYERDLL	PlayerDll(m_pLibName->c_str(), m_InstanceId);
+			m_bFailed = !m_pOpenedDll->Get() || !PlayerDll.Open(Params.m_RuleOpt.c_str());
+			if (m_bFailed) {
+				TCVERBOSE("open failed.");
+			} else {
+				// ラウンド N のピース列は、シードで初期化した乱数ジェネレータで N 回目に生成したもの
+				TCRANDOMGENERATOR	Seeder(m_Seed);
+				for (size_t round = 1; round < m_Round; round++) {
+					Seeder.Get();
+				}
+				TCPIECESEQUENCE	Sequence = TCGAMECONTROL::MakeSeededSequence(Seeder);
+
+				PlayField.StartGame(Sequence, PlayerDll.Get());
+				while (PlayField.IsPlaying()) {
+					if (m_bFastForward) {
+						size_t	Frames = 0;
+						PlayField.Tick(PlayerDll.Get(), FAST_FORWARD_FRAME, Frames);
+						m_FrameCount += Frames;
+					} else {
+						PlayField.Tick(PlayerDll.Get());
+						m_FrameCount++;
+					}
+				}
+				m_PieceCount = static_cast<size_t>(PlayField.GetScore().GetPieces());
+			}
+
+			std::strstream	Result;
+			Result
+				<< "VER=" << TCGAMECONTROL::GetVersion()
+				<< "&DATE=" << TCSTRING::Embed("<yymmdd><hhmmss>")
+				<< "&HOST=" << *m_pHostname
+				<< "&" << Params.m_RuleOpt
+				<< "&SEED=" << m_Seed
+				<< "&R=" << m_Round
+				<< "&ENTRY=" << m_PlayerIdx
+				<< ",";
+			if (m_bFailed) {
+				// スコアの代わりに、開けなかった DLL を出力する
+				Result
+					<< "LIB=" << TCSTRING::Sanitize(*m_pLibName)
+					<< "&ERROR=OPEN";
+			} else {
+				Result
+					<< PlayerDll.Get()->GetString()
+					<< "&"
+					<< PlayField.GetScore().GetString();
+			}
+			Result << std::ends;
+			m_Result = std::string(Result.str());
+
+		} // end of TCTOURNAMENT::JOBTASK::Exec
+	};
+
+	//
+	// variable
+	//
+protected:
+	TCSTRINGLIST				m_ViewList;
+	std::string					m_ReportDst;
+	std::string					m_Hostname;
+	size_t						m_ThreadCount;	// ワーカスレッドの数（ViewOpt の T。0 または省略時は論理プロセッサ数）
+	bool						m_bFastForward;	// 変化のないフレームを早送りするかどうか（ViewOpt の FF=1）
+	std::vector<std::string>	m_PlayerLibs;	// 登録順のプレイヤ DLL のファイル名
+	std::vector<PARAMS>			m_Params;		// 登録順のパラメタセット
+	std::vector<uint32_t>		m_Seeds;		// 登録順のシード
+	std::vector<TCPLAYERDLL*>	m_PlayerDlls;	// メインスレッドで開いたプレイヤ（パラメタセット × プレイヤの登録順。Run の間だけ保持する）
+
+	std::ofstream				m_Report;		// 結果の出力先
+	size_t						m_JobCount;		// ジョブ数
+	size_t						m_DoneCount;	// 終わったジョブ数
+	size_t						m_FailedCount;	// プレイヤを開けずに終わったジョブ数
+	size_t						m_FrameCount;	// 終わったジョブで進行させたフレーム数の合計
+	size_t						m_PieceCount;	// 終わったジョブで落下させたピース数の合計
+	DWORD						m_msStart;		// 実行を開始した時刻
+	DWORD						m_msProgress;	// 最後に進捗を表示した時刻
+
+	//
+	// method
+	//
+public:
+	/*!
+		標準のコンストラクタです。
+		@param[in] ViewOpt 実行オプション（T・FF）
+		@param[in] ReportDst 結果を出力するファイル名（<yymmdd>・<hhmmss> は日時に置き換える）
+	*/
+	TCTOURNAMENT(const std::string &ViewOpt, const std::string &ReportDst)
+		: m_ViewList(ViewOpt),
+		m_ReportDst(TCSTRING::Embed(ReportDst)),
+		m_Hostname(TCGAMECONTROL::GetHostname()),
+		m_ThreadCount(0),
+		m_bFastForward(false),
+		m_PlayerLibs(),
+		m_Params(),
+		m_Seeds(),
+		m_PlayerDlls(),
+		m_Report(),
+		m_JobCount(0),
+		m_DoneCount(0),
+		m_FailedCount(0),
+		m_FrameCount(0),
+		m_PieceCount(0),
+		m_msStart(0),
+		m_msProgress(0)
+	{
+		m_ThreadCount = max(m_ViewList.GetInteger("T"), 0);
+		m_bFastForward = (m_ViewList.GetInteger("FF") != 0);
+
+	} // end of TCTOURNAMENT::ctor
+
+	virtual ~TCTOURNAMENT()
+	{
+		ClosePlayer();
+
+	} // end of TCTOURNAMENT::dtor
+
+	void	AddPlayer(const char *strLibName)
+	{
+		m_PlayerLibs.push_back(std::string(strLibName));
+
+	} // end of TCTOURNAMENT::AddPlayer
+
+	/*!
+		パラメタセットを登録します。
+		@param[in] RuleOpt ルール（TCGAMECONTROL の RuleOpt と同じ。R はシードごとのラウンド数、SEED は使わない）
+	*/
+	void	AddParams(const std::string &RuleOpt)
+	{
+		TCSTRINGLIST	RuleList(RuleOpt);
+		TCASSERT(RuleList.GetInteger("W") >= 4, "RuleOpt invalid.");
+		TCASSERT(RuleList.GetInteger("H") >= 4, "RuleOpt invalid.");
+		TCASSERT(RuleList.GetInteger("G") > 0, "RuleOpt invalid.");
+		TCASSERT(RuleList.GetInteger("R") > 0, "RuleOpt invalid.");
+
+		PARAMS	Params;
+		Params.m_RuleOpt = RuleList.GetString();
+		Params.m_Width = static_cast<int8_t>(RuleList.GetInteger("W"));
+		Params.m_Height = static_cast<int8_t>(RuleList.GetInteger("H"));
+		Params.m_Gravity = static_cast<size_t>(RuleList.GetInteger("G"));
+		Params.m_RoundCount = static_cast<size_t>(RuleList.GetInteger("R"));
+		m_Params.push_back(Params);
+
+	} // end of TCTOURNAMENT::AddParams
+
+	/*!
+		シードを登録します。
+		シードはカンマで区切って複数指定でき、「開始-終了」で範囲を指定できます（例：「1,5,10-19」）。
+		登録できるシードは、合わせて SEED_COUNT_MAX 個までです。
+		@param[in] strSeeds シード（1～）
+		@retval true 成功
+		@retval false 書式が正しくない or シードが多すぎる
+	*/
+	bool	AddSeeds(const std::string &strSeeds)
+	{
+		return ParseSeeds(strSeeds, m_Seeds);
+
+	} // end of TCTOURNAMENT::AddSeeds
+
+	/*!
+		シードの指定を展開します（書式は AddSeeds と同じ）。
+		@param[in] strSeeds シード（1～）
+		@param[out] Seeds 展開したシードの追加先
+		@retval true 成功
+		@retval false 書式が正しくない or 追加先と合わせて SEED_COUNT_MAX 個を超える
+	*/
+	static bool	ParseSeeds(const std::string &strSeeds, std::vector<uint32_t> &Seeds)
+	{
+		std::string::size_type	pos = 0;
+		while (pos < strSeeds.size()) {
+			std::string::size_type	end = strSeeds.find(',', pos);
+			if (end == strSeeds.npos) {
+				end = strSeeds.size();
+			}
+			std::string	Item = strSeeds.substr(pos, end - pos);
+			pos = end + 1;
+
+			char			*pEnd = NULL;
+			unsigned long	First = strtoul(Item.c_str(), &pEnd, 10);
+			unsigned long	Last = First;
+			if (*pEnd == '-') {
+				Last = strtoul(pEnd + 1, &pEnd, 10);
+			}
+			if ((*pEnd != '\0') || (First == 0) || (Last < First) || (Last > 0xffffffffUL) || Item.empty()) {
+				return false;
+			}
+			if (
+				(Seeds.size() >= SEED_COUNT_MAX) ||
+				(Last - First >= SEED_COUNT_MAX - Seeds.size())
+			) {
+				return false;
+			}
+			// Last が型の最大値でも回り込まないように、Last を追加したところで抜ける
+			for (unsigned long seed = First; ; seed++) {
+				Seeds.push_back(static_cast<uint32_t>(seed));
+				if (seed == Last) {
+					break;
+				}
+			}
+		}
+		return Seeds.size() > 0;
+
+	} // end of TCTOURNAMENT::ParseSeeds
+
+	/*!
+		すべてのジョブを実行します。
+		ジョブが終わるたびに結果を出力し、実行中は一定間隔で進捗と実行速度を表示します。
+	*/
+	void	Run()
+	{
+		TCASSERT(m_PlayerLibs.size() > 0, "no player.");
+		TCASSERT(m_Params.size() > 0, "no params.");
+		TCASSERT(m_Seeds.size() > 0, "no seed.");
+
+		// ワーカスレッドから使うテーブルを、先にメインスレッドで構築しておく
+		TCPIECE::Prepare();
+		OpenPlayer();
+
+		// 同じピース列を使うジョブが隣り合うように並べる
+		std::vector<TCTHREADPOOL::TASK*>	Tasks;
+		for (size_t pp = 0; pp < m_Params.size(); pp++) {
+			for (size_t ss = 0; ss < m_Seeds.size(); ss++) {
+				for (size_t round = 1; round <= m_Params[pp].m_RoundCount; round++) {
+					for (size_t ii = 0; ii < m_PlayerLibs.size(); ii++) {
+						const TCPLAYERDLL	*pOpenedDll = m_PlayerDlls[pp * m_PlayerLibs.size() + ii];
+						Tasks.push_back(new JOBTASK(&m_PlayerLibs[ii], pOpenedDll, ii, GetInstanceId(ii), &m_Params[pp], &m_Hostname, m_Seeds[ss], round, m_bFastForward));
+					}
+				}
+			}
+		}
+
+		m_Report.open(m_ReportDst.c_str(), std::ios::out | std::ios::app);
+		TCASSERT(m_Report.is_open(), "file not opened.");
+
+		m_JobCount = Tasks.size();
+		m_DoneCount = 0;
+		m_FailedCount = 0;
+		m_FrameCount = 0;
+		m_PieceCount = 0;
+		m_msStart = GetTickCount();
+		m_msProgress = m_msStart;
+		{
+			TCTHREADPOOL	Pool(m_ThreadCount);
+			Pool.Run(Tasks, this);
+		}
+		m_Report.close();
+		std::cerr << std::endl;
+
+		for (size_t ii = 0; ii < Tasks.size(); ii++) {
+			delete Tasks[ii];
+			Tasks[ii] = NULL;
+		}
+		ClosePlayer();
+
+	} // end of TCTOURNAMENT::Run
+
+	/*!
+		ジョブ数を返します。
+		@return ジョブ数
+	*/
+	size_t	GetJobCount() const
+	{
+		return m_JobCount;
+
+	} // end of TCTOURNAMENT::GetJobCount
+
+	/*!
+		プレイヤを開けずに終わったジョブ数を返します（結果には、スコアの代わりに ERROR=OPEN を出力しています）。
+		@return ジョブ数
+	*/
+	size_t	GetFailedCount() const
+	{
+		return m_FailedCount;
+
+	} // end of TCTOURNAMENT::GetFailedCount
+
+	/*!
+		全ジョブで進行させたフレーム数の合計を返します（Run の後に、実行速度を求めるために使用します）。
+		@return フレーム数
+	*/
+	size_t	GetFrameCount() const
+	{
+		return m_FrameCount;
+
+	} // end of TCTOURNAMENT::GetFrameCount
+
+	/*!
+		全ジョブで落下させたピース数の合計を返します（Run の後に、実行速度を求めるために使用します）。
+		@return ピース数
+	*/
+	size_t	GetPieceCount() const
+	{
+		return m_PieceCount;
+
+	} // end of TCTOURNAMENT::GetPieceCount
+
+private:
+	/*!
+		ジョブが終わるたびに、結果を出力して集計します。
+		スレッドプールが呼び出しを直列化するので、ロックは不要です。
+		@param[in/out] pTask 終わったジョブ
+	*/
+	void	OnDone(TCTHREADPOOL::TASK *pTask)
+	{
+		JOBTASK	*pJob = static_cast<JOBTASK*>(pTask);
+
+		m_Report << pJob->m_Result << std::endl;
+		std::string().swap(pJob->m_Result);
+
+		m_DoneCount++;
+		if (pJob->m_bFailed) {
+			m_FailedCount++;
+		}
+		m_FrameCount += pJob->m_FrameCount;
+		m_PieceCount += pJob->m_PieceCount;
+
+		DWORD	msNow = GetTickCount();
+		if ((msNow - m_msProgress >= PROGRESS_INTERVAL) || (m_DoneCount == m_JobCount)) {
+			m_msProgress = msNow;
+			double	secElapsed = max(msNow - m_msStart, 1) / 1000.0;
+			std::cerr
+				<< "\r"
+				<< m_DoneCount << "/" << m_JobCount << " jobs ("
+				<< static_cast<size_t>(m_DoneCount / secElapsed) << " jobs/s, "
+				<< static_cast<size_t>(m_FrameCount / secElapsed) << " frames/s)   "
+				<< std::flush;
+		}
+
+	} // end of TCTOURNAMENT::OnDone
+
+	/*!
+		パラメタセットとプレイヤの組み合わせごとに、プレイヤをメインスレッドで一度ずつ開きます。
+		DLL は Run の間ロードしたままにするので、DLL 内のテーブルもメインスレッドで構築され、ジョブごとにロードし直すこともありません。
+		開けなかった組み合わせのジョブは、ゲームを実行せずに失敗の結果を出力します。
+	*/
+	void	OpenPlayer()
+	{
+		ClosePlayer();
+		for (size_t pp = 0; pp < m_Params.size(); pp++) {
+			for (size_t ii = 0; ii < m_PlayerLibs.size(); ii++) {
+				TCPLAYERDLL	*pPlayerDll = new TCPLAYERDLL(m_PlayerLibs[ii].c_str(), GetInstanceId(ii));
+				TCASSERT(pPlayerDll != NULL, "alloc null.");
+				if (!pPlayerDll->Open(m_Params[pp].m_RuleOpt.c_str())) {
+					TCVERBOSE("open failed.");
+					pPlayerDll->Close();
+				}
+				m_PlayerDlls.push_back(pPlayerDll);
+			}
+		}
+
+	} // end of TCTOURNAMENT::OpenPlayer
+
+	void	ClosePlayer()
+	{
+		for (size_t ii = 0; ii < m_PlayerDlls.size(); ii++) {
+			delete m_PlayerDlls[ii];
+			m_PlayerDlls[ii] = NULL;
+		}
+		m_PlayerDlls.clear();
+
+	} // end of TCTOURNAMENT::ClosePlayer
+
+	/*!
+		登録されたプレイヤに割り当てるインスタンス ID を返します（TCGAMECONTROL::GetInstanceId と同じ）。
+		@param[in] PlayerIdx プレイヤの登録順（0～）
+		@return インスタンス ID
+	*/
+	size_t	GetInstanceId(size_t PlayerIdx) const
+	{
+		size_t	InstanceId = 0;
+		for (size_t ii = 0; ii < PlayerIdx; ii++) {
+			if (m_PlayerLibs[ii] == m_PlayerLibs[PlayerIdx]) {
+				InstanceId++;
+			}
+		}
+		return InstanceId;
+
+	} // end of TCTOURNAMENT::GetInstanceId
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif	// TCTOURNAMENT_H
@@ -38,6 +38,8 @@ typedef unsigned short	uint16_t;	//!< 16bit 符号なし整数
 typedef signed short	int16_t;	//!< 16bit 符号あり整数
 typedef unsigned long	uint32_t;	//!< 32bit 符号なし整数
 typedef signed long		int32_t;	//!< 32bit 符号あり整数
+typedef unsigned __int64	uint64_t;	//!< 64bit 符号なし整数
+typedef signed __int64	int64_t;	//!< 64bit 符号あり整数
 typedef unsigned int	size_t;		//!< サイズ指定なしの符号なし整数
 typedef signed int		ssize_t;	//!< サイズ指定なしの符号あり整数
 
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2010, Abe Chanta
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+// - Redistributions of source code must retain the above copyright notice,
+//   this list of conditions and the following disclaimer.
+// - Redistributions in binary form must reproduce the above copyright notice,
+//   this list of conditions and the following disclaimer in the documentation
+//   and/or other materials provided with the distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+// THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+// OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+// WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+// OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+// ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#ifndef TCVIEW_NULL_H
+#define TCVIEW_NULL_H
+//! @file
+
+#include <vector>
+#include "tctype.h"
+#include "tcview.h"
+
+//----------------------------------------------------------------------------
+/*!
+	何も出力しない画面出力です。
+	画面を見る必要のないバッチ実行（ヘッドレスモード）で使用します。
+	マップを保持しないので、描画はすべて何もせずに戻ります。
+*/
+class TCVIEW_NULL : public TCVIEW
+{
+	//
+	// variable
+	//
+protected:
+	int8_t		m_Size[TC::XYZ];	//!< マップのサイズ
+
+	//
+	// method
+	//
+public:
+	TCVIEW_NULL(int8_t Width, int8_t Height, int8_t Layer)
+		: TCVIEW(Width, Height, Layer)
+	{
+		m_Size[TC::X] = Width;
+		m_Size[TC::Y] = Height;
+		m_Size[TC::Z] = Layer;
+
+	} // end of TCVIEW_NULL::ctor
+
+	TCSIZE	GetSize() const
+	{
+		return TCSIZE(m_Size[TC::X], m_Size[TC::Y]);
+
+	} // end of TCVIEW_NULL::GetSize
+
+	void	Clear()
+	{
+	} // end of TCVIEW_NULL::Clear
+
+	void	Paint()
+	{
+	} // end of TCVIEW_NULL::Paint
+
+	void	Draw(const LOCATOR &Loc, CELL Cid)
+	{
+	} // end of TCVIEW_NULL::Draw
+
+	void	DrawFont(const LOCATOR &Loc, char Chr, TRANSFUNC pfTrans = NULL)
+	{
+	} // end of TCVIEW_NULL::DrawFont
+
+	void	Draw(const LOCATOR &Loc, const std::vector<CELL> &CidLine)
+	{
+	} // end of TCVIEW_NULL::Draw
+
+	void	DrawFont(const LOCATOR &Loc, const std::string &ChrLine, TRANSFUNC pfTrans = NULL)
+	{
+	} // end of TCVIEW_NULL::DrawFont
+
+	void	Draw(const LOCATOR &Loc, const std::vector<std::vector<CELL> > &CidRect)
+	{
+	} // end of TCVIEW_NULL::Draw
+
+	void	DrawFont(const LOCATOR &Loc, const std::vector<std::string> &ChrRect, TRANSFUNC pfTrans = NULL)
+	{
+	} // end of TCVIEW_NULL::DrawFont
+};
+
+
+
+//----------------------------------------------------------------------------
+#endif // TCVIEW_NULL_H
@@ -36,6 +36,7 @@
 #include <windows.h>
 #include <fstream>
 #include <string>
+#include <strstream>
 #include <vector>
 #include "tctype.h"
 #include "tcevent.h"
@@ -104,10 +105,13 @@ private:
 	//
 private:
 	static size_t		m_DebugLevel;
+	static LONG			m_SlotMask[8];		// InstanceId ごとの、生存しているインスタンスが使っている通し番号のビット
+	LONG				m_Slot;				// ファイル名に付けた通し番号（-1 は未使用）
 	TCPATH				m_Path;
 	std::ofstream		m_LogFile;
 	std::ofstream		m_ResFile;
 
+	bool				m_bNarrowField;
 	TCPIECE				m_Target;
 	ssize_t				m_EvalPts;
 	int8_t				m_HeightRatio;
@@ -130,21 +134,53 @@ public:
 
 	} // end of ATPLAYER1::IsAvailable
 
-	ATPLAYER1(const char *strPath, const char *strRule)
-		: TCPLAYER(strPath, strRule),
+	ATPLAYER1(const char *strPath, const char *strRule, size_t InstanceId)
+		: TCPLAYER(strPath, strRule, InstanceId),
 		m_Path(strPath),
 		m_LogFile(),
 		m_ResFile(),
+		m_Slot(-1),
+		m_bNarrowField(false),
 		m_Target(),
 		m_EvalPts(0)
 	{
+		// 並列実行では同じ InstanceId のインスタンスが同時に存在するので、生存しているインスタンスの間で空いている最小の通し番号を使い、１以上ならファイル名に付ける
+		std::string	Suffix;
+		if (
+			(m_InstanceId < 8)
+		) {
+			for (;;) {
+				LONG	Mask = m_SlotMask[m_InstanceId];
+				LONG	Slot = 0;
+				while (
+					(Slot < 31) &&
+					(Mask & (1L << Slot))
+				) {
+					Slot++;
+				}
+				TCASSERT(Slot < 31, "too many instances.");
+				if (Slot >= 31) {
+					break;
+				}
+				if (InterlockedCompareExchange(&m_SlotMask[m_InstanceId], Mask | (1L << Slot), Mask) == Mask) {
+					m_Slot = Slot;
+					break;
+				}
+			}
+			if (m_Slot > 0) {
+				std::strstream	Value;
+				Value << "-" << m_Slot << std::ends;
+				Suffix = Value.str();
+			}
+		}
+
 #if DEBUG
 		if (
 			(m_DebugLevel >= 1) &&
 			(m_InstanceId < 8)
 		) {
 			std::string	LogFile;
-			LogFile.append(GetName()).append("\\").append(1, "01234567"[m_InstanceId]).append(".log");
+			LogFile.append(GetName()).append("\\").append(1, "01234567"[m_InstanceId]).append(Suffix).append(".log");
 			m_LogFile.open(m_Path.Concat(LogFile).c_str(), std::ios::out);
 			TCASSERT(m_LogFile.is_open(), "file not opened.");
 		}
@@ -153,9 +189,10 @@ public:
 			(m_InstanceId < 8)
 		) {
 			std::string	ResFile;
-			ResFile.append(GetName()).append("\\").append("<yymmdd>_<hhmmss>_").append(1, "01234567"[m_InstanceId]).append(".txt");
+			ResFile.append(GetName()).append("\\").append("<yymmdd>_<hhmmss>_").append(1, "01234567"[m_InstanceId]).append(Suffix).append(".txt");
 			ResFile = TCSTRING::Embed(ResFile);
-			m_ResFile.open(m_Path.Concat(ResFile).c_str(), std::ios::out);
+			// 通し番号は後のインスタンスが再び使うので、同じ秒に作られたファイルは上書きせずに追記する
+			m_ResFile.open(m_Path.Concat(ResFile).c_str(), std::ios::out | std::ios::app);
 			TCASSERT(m_ResFile.is_open(), "file not opened.");
 		}
 
@@ -190,10 +227,8 @@ public:
 
 		{
 			// tweak params
-			TCRANDOMGENERATOR	randgen(0);
-			for (size_t ii = 0; ii < m_InstanceId; ii++) {
-				randgen.Get();
-			}
+			// 同じ InstanceId のインスタンスが同じ調整になるように、種は時刻ではなく InstanceId から決める
+			TCRANDOMGENERATOR	randgen(static_cast<uint32_t>(m_InstanceId) + 1);
 			switch ((randgen.Get() / 17) % 26) {
 			case 0:		m_HeightRatio++; break;
 			case 1:		m_HeightRatio--; break;
@@ -241,10 +276,25 @@ public:
 
 	~ATPLAYER1()
 	{
+		// 通し番号を返して、後から作られるインスタンスが使えるようにする
+		m_ResFile.close();
+		m_LogFile.close();
+		if (m_Slot >= 0) {
+			for (;;) {
+				LONG	Mask = m_SlotMask[m_InstanceId];
+				if (InterlockedCompareExchange(&m_SlotMask[m_InstanceId], Mask & ~(1L << m_Slot), Mask) == Mask) {
+					break;
+				}
+			}
+		}
+
 	} // end of ATPLAYER1::dtor
 
 	void	StartGame(const TCFIELD &Field)
 	{
+		// 探索に使うフィールドの型は、幅に合わせてゲーム開始時に一度だけ決める
+		m_bNarrowField = (Field.GetSize().GetX() - 2 <= TCFIELD16::FIELD_WIDTH_MAX);	// -2 is for frame
+
 	} // end of ATPLAYER1::StartGame
 
 	void	EndGame(const TCSCORE &Score)
@@ -262,143 +312,148 @@ public:
 		}
 
 		if (Event & TCEVENT_PREP) {
-#if DEBUG
-			if (m_DebugLevel >= 1) {
-				m_LogFile << "-------------------------------------------------------------------------------" << std::endl;
-			}
-#endif
+			Search(Field, CtrlPiece, true);
+		}
 
-			TCPIECE	TargetU, TargetD;
-			TargetU = CtrlPiece.MoveY(CtrlPiece.GetTopOfsY() - 1);	// -1 is for frame
-			TargetD = ATU::LimitD(Field, TargetU);
-			m_EvalPts = Eval(Field, TargetD);
-			m_Target = TargetD;
+		if ((Event & TCEVENT_FALL) && (Event & (TCEVENT_nMOVE_L | TCEVENT_nMOVE_R))) {
+			Search(Field, CtrlPiece, false);
+		}
 
-			for (uint8_t Rot = 0; Rot < CtrlPiece.GetRotMax(); Rot++) {
-				TargetU = CtrlPiece;
-				TargetU.m_Rot = Rot;
-				TargetU = TargetU.MoveY(TargetU.GetTopOfsY() - 1);	// -1 is for frame
+		return ATU::GetMoveEvent(CtrlPiece, m_Target) | ATU::GetRotEvent(CtrlPiece, m_Target);
 
-				if (!Field.IsSetPiece(TargetU)) {
-					continue;
-				}
+	} // end of ATPLAYER1::Exec
 
-				if (Rot != 0) {
-					TargetD = ATU::LimitD(Field, TargetU);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
-				}
+	bool	GetPlacement(TCEVENT Event, const TCFIELD &Field, const TCPIECE &CtrlPiece, const TCPIECE &NextPiece, TCPIECE &Target)
+	{
+		if (Event & TCEVENT_GAME_OVER) {
+			return false;
+		}
 
-				TCPIECE	LimitL = ATU::LimitL(Field, TargetU);
-				while (ATU::operator !=(LimitL, TargetU)) {
-					TargetD = ATU::LimitD(Field, LimitL);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
-					LimitL = LimitL.MoveX(-1);
-				}
+		// ピースの出現時にだけ呼ばれる
+		Search(Field, CtrlPiece, true);
 
-				TCPIECE	LimitR = ATU::LimitR(Field, TargetU);
-				while (ATU::operator !=(LimitR, TargetU)) {
-					TargetD = ATU::LimitD(Field, LimitR);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
-					LimitR = LimitR.MoveX(+1);
-				}
-			}
+		// 探索した配置までの入力は、ゲーム側に任せる
+		Target = m_Target;
+		return true;
+
+	} // end of ATPLAYER1::GetPlacement
+
+	bool	IsStationary() const
+	{
+		// 探索結果はフィールドとピースだけで決まる
+		return true;
+
+	} // end of ATPLAYER1::IsStationary
+
+	void	Search(const TCFIELD &Field, const TCPIECE &CtrlPiece, bool bFromTop)
+	{
+		if (m_bNarrowField) {
+			// 幅が狭ければ１段 16bit のフィールドに変換してから探索する
+			Search_Row(TCFIELD16(Field), CtrlPiece, bFromTop);
+		} else {
+			Search_Row(Field, CtrlPiece, bFromTop);
 		}
 
-		if ((Event & TCEVENT_FALL) && (Event & (TCEVENT_nMOVE_L | TCEVENT_nMOVE_R))) {
-			// TODO: copy and paste
+	} // end of ATPLAYER1::Search
+
+	template <typename ROW>
+	void	Search_Row(const TCFIELDT<ROW> &Field, const TCPIECE &CtrlPiece, bool bFromTop)
+	{
 #if DEBUG
-			if (m_DebugLevel >= 1) {
-				m_LogFile << "-------------------------------------------------------------------------------" << std::endl;
-			}
+		if (m_DebugLevel >= 1) {
+			m_LogFile << "-------------------------------------------------------------------------------" << std::endl;
+		}
 #endif
 
-			TCPIECE	TargetU, TargetD;
-//			TargetU = CtrlPiece.MoveY(CtrlPiece.GetTopOfsY() - 1);	// -1 is for frame
-			TargetU = CtrlPiece;
-			TargetD = ATU::LimitD(Field, TargetU);
-			m_EvalPts = Eval(Field, TargetD);
-			m_Target = TargetD;
-
-			for (uint8_t Rot = 0; Rot < CtrlPiece.GetRotMax(); Rot++) {
-				TargetU = CtrlPiece;
-				TargetU.m_Rot = Rot;
-//				TargetU = TargetU.MoveY(TargetU.GetTopOfsY() - 1);	// -1 is for frame
+		TCFIELDT<ROW>	Work(Field);
+		TCPIECE	TargetU, TargetD;
+		TargetU = CtrlPiece;
+		if (bFromTop) {
+			TargetU = TargetU.MoveY(TargetU.GetTopOfsY() - 1);	// -1 is for frame
+		}
+		TargetD = ATU::LimitD(Field, TargetU);
+		m_EvalPts = Eval(Work, TargetD);
+		m_Target = TargetD;
 
-				if (!Field.IsSetPiece(TargetU)) {
-					continue;
-				}
+		// 回転ごとに、すべての X 位置の着地位置をまとめて求めておく
+		int8_t	DropY[TCFIELDT<ROW>::DROP_COUNT];
+		for (uint8_t Rot = 0; Rot < CtrlPiece.GetRotMax(); Rot++) {
+			TargetU = CtrlPiece;
+			TargetU.m_Rot = Rot;
+			if (bFromTop) {
+				TargetU = TargetU.MoveY(TargetU.GetTopOfsY() - 1);	// -1 is for frame
+			}
 
-				if (Rot != 0) {
-					TargetD = ATU::LimitD(Field, TargetU);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
+			if (!Field.IsSetPiece(TargetU)) {
+				continue;
+			}
+			Field.GetDropY(TargetU, DropY);
+			ssize_t	idx = TargetU.m_Pos.GetX() - TCPIECE::MASK_POS_X_MIN;
+
+			if (Rot != 0) {
+				TargetD = TargetU.MoveY(static_cast<int8_t>(DropY[idx] - TargetU.m_Pos.GetY()));
+				ssize_t	Score = Eval(Work, TargetD);
+				if (m_EvalPts < Score) {
+					m_EvalPts = Score;
+					m_Target = TargetD;
 				}
+			}
 
-				TCPIECE	LimitL = ATU::LimitL(Field, TargetU);
-				while (ATU::operator !=(LimitL, TargetU)) {
-					TargetD = ATU::LimitD(Field, LimitL);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
-					LimitL = LimitL.MoveX(-1);
+			ssize_t	LimitL = idx;
+			while ((LimitL + 1 < static_cast<ssize_t>(TCFIELDT<ROW>::DROP_COUNT)) && (DropY[LimitL + 1] != TCFIELDT<ROW>::DROP_NONE)) {
+				LimitL++;
+			}
+			for (; LimitL != idx; LimitL--) {
+				TargetD = TargetU.MoveX(static_cast<int8_t>(LimitL - idx)).MoveY(static_cast<int8_t>(DropY[LimitL] - TargetU.m_Pos.GetY()));
+				ssize_t	Score = Eval(Work, TargetD);
+				if (m_EvalPts < Score) {
+					m_EvalPts = Score;
+					m_Target = TargetD;
 				}
+			}
 
-				TCPIECE	LimitR = ATU::LimitR(Field, TargetU);
-				while (ATU::operator !=(LimitR, TargetU)) {
-					TargetD = ATU::LimitD(Field, LimitR);
-					ssize_t	Score = Eval(Field, TargetD);
-					if (m_EvalPts < Score) {
-						m_EvalPts = Score;
-						m_Target = TargetD;
-					}
-					LimitR = LimitR.MoveX(+1);
+			ssize_t	LimitR = idx;
+			while ((LimitR - 1 >= 0) && (DropY[LimitR - 1] != TCFIELDT<ROW>::DROP_NONE)) {
+				LimitR--;
+			}
+			for (; LimitR != idx; LimitR++) {
+				TargetD = TargetU.MoveX(static_cast<int8_t>(LimitR - idx)).MoveY(static_cast<int8_t>(DropY[LimitR] - TargetU.m_Pos.GetY()));
+				ssize_t	Score = Eval(Work, TargetD);
+				if (m_EvalPts < Score) {
+					m_EvalPts = Score;
+					m_Target = TargetD;
 				}
 			}
 		}
 
-		return ATU::GetMoveEvent(CtrlPiece, m_Target) | ATU::GetRotEvent(CtrlPiece, m_Target);
-
-	} // end of ATPLAYER1::Exec
+	} // end of ATPLAYER1::Search_Row
 
-	ssize_t	Eval(const TCFIELD &Field, const TCPIECE &Piece)
+	template <typename ROW>
+	ssize_t	Eval(TCFIELDT<ROW> &Field, const TCPIECE &Piece)
 	{
-		return Eval(ATU::operator +(Field, Piece));
+		// フィールドをコピーせず、配置して評価した後に元に戻す
+		typename TCFIELDT<ROW>::UNDO	Undo = Field.MakeMove(Piece);
+		ssize_t	Value = Eval(Field, Undo.GetLines());
+		Field.UnmakeMove(Undo);
+		return Value;
 
 	} // end of ATPLAYER1::Eval
 
-	ssize_t	Eval(const TCFIELD &oField)
+	template <typename ROW>
+	ssize_t	Eval(const TCFIELDT<ROW> &Field, int8_t Lines)
 	{
-		TCFIELD	Field(oField);
 		int8_t	ww = static_cast<int8_t>(Field.GetSize().GetX());
 		int8_t	hh = static_cast<int8_t>(Field.GetSize().GetY());
 
 		ssize_t	LinesBonus = 0;
 		{
-			size_t	idx = Field.CheckLines();
+			size_t	idx = Lines;
 			if (idx >= m_LinePts.size()) {
 				idx = m_LinePts.size() - 1;
 			}
 			LinesBonus += m_LinePts[idx];
 		}
 
-		Field.RemoveLines();
 		std::vector<int8_t>	Spots = ATU::GetSpots(Field);
 		std::vector<int8_t>	Height = ATU::GetHeight(Field);
 		std::vector<int8_t>	SpotHeight = ATU::GetSpotHeight(Field);
@@ -491,15 +546,15 @@ public:
 				int8_t	tmpY = hh - 1 - yy;
 				for (int8_t xx = 1; xx < ww - 1; xx++) {
 					int8_t	tmpX = ww - 1 - xx;
-					m_LogFile << (oField.GetBitmap(tmpX, tmpY) ? '@' : '.');
+					m_LogFile << (Field.GetBitmap(tmpX, tmpY) ? '@' : '.');
 				}
 				m_LogFile << std::endl;
 			}
 #else
 			for (int8_t yy = 1; yy < hh - 1; yy++) {
 				int8_t	tmpY = hh - 1 - yy;
-				uint32_t	line = oField.GetBitmap(tmpY);
-				uint32_t	mask = TCBIT::Get(ww);
+				ROW		line = Field.GetBitmap(tmpY);
+				ROW		mask = TCFIELDT<ROW>::BIT::Get(ww);
 				mask >>= 1;	// dummy for frame
 				for (ssize_t xx = 1; xx < ww - 1; xx++) {
 					mask >>= 1;
@@ -518,3 +573,4 @@ public:
 
 TCEXPORT_TCPLAYER(ATPLAYER1, "ATPLAYER1.01", "Abe Chanta")
 size_t	ATPLAYER1::m_DebugLevel = ATPLAYER1::DEBUG_LEVEL_DEFAULT;
+LONG	ATPLAYER1::m_SlotMask[8] = { 0 };
@@ -43,112 +43,59 @@ namespace ATU
 	//
 	size_t	CountBit(uint32_t bitmap, size_t width = 32)
 	{
-#if 0
-		size_t	Value = bitmap;
-		Value = ((Value >> 0) & 0x55555555U) + ((Value >> 1) & 0x55555555U);
-		Value = ((Value >> 0) & 0x33333333U) + ((Value >> 2) & 0x33333333U);
-		Value = ((Value >> 0) & 0x0F0F0F0FU) + ((Value >> 4) & 0x0F0F0F0FU);
-		Value = ((Value >> 0) & 0x00FF00FFU) + ((Value >> 8) & 0x00FF00FFU);
-		Value = ((Value >> 0) & 0x0000FFFFU) + ((Value >> 16) & 0x0000FFFFU);
-		return Value;
-#else
-		static const size_t	BitCount[32] = {
-			0+0,	0+1,	0+1,	0+2,	0+1,	0+2,	0+2,	0+3,
-			1+0,	1+1,	1+1,	1+2,	1+1,	1+2,	1+2,	1+3,
-			1+0,	1+1,	1+1,	1+2,	1+1,	1+2,	1+2,	1+3,
-			2+0,	2+1,	2+1,	2+2,	2+1,	2+2,	2+2,	2+3,
-		};
-
-		size_t	Value = 0;
-		for (size_t ii = 0; ii < width; ii += 5) {
-			Value += BitCount[bitmap & 0x0000001FU];
-			bitmap >>= 5;
-		}
-		return Value;
-#endif
+		return TCBIT::Count(bitmap, width);
 
 	} // end of ATU::CountBit
 
-	size_t	CountSpots(const TCFIELD &Field)
+	template <typename ROW>
+	size_t	CountSpots(const TCFIELDT<ROW> &Field)
 	{
-		size_t		Value = 0;
-		uint32_t	BlockFoundMask = 0;	// 0 means vacant space above.
-		for (int8_t yy = Field.GetSize().GetY() - 2; yy >= 1; yy--) {	// from TOP to BOTTOM
-			uint32_t	Bitmap = Field.GetBitmap(yy) & Field.GetLineFilled();
-			Value += ATU::CountBit(~Bitmap & BlockFoundMask, Field.GetSize().GetX());
-			BlockFoundMask |= Bitmap;
-		}
-		return Value;
+		return Field.CountSpots();
 
 	} // end of ATU::CountSpots
 
-	std::vector<int8_t>	GetSpots(const TCFIELD &Field)
+	template <typename ROW>
+	std::vector<int8_t>	GetSpots(const TCFIELDT<ROW> &Field)
 	{
 		std::vector<int8_t>	Value;
 		Value.resize(Field.GetSize().GetY());
-		uint32_t	BlockFoundMask = 0;	// 0 means vacant space above.
-		for (int8_t yy = Field.GetSize().GetY() - 2; yy >= 1; yy--) {	// from TOP to BOTTOM
-			uint32_t	Bitmap = Field.GetBitmap(yy) & Field.GetLineFilled();
-			Value[yy] = static_cast<int8_t>(ATU::CountBit(~Bitmap & BlockFoundMask, Field.GetSize().GetX()));
-			BlockFoundMask |= Bitmap;
+		for (int8_t yy = 1; yy < Field.GetSize().GetY() - 1; yy++) {
+			Value[yy] = Field.GetSpots(yy);
 		}
 		return Value;
 
 	} // end of ATU::GetSpots
 
-	std::vector<int8_t>	GetHeight(const TCFIELD &Field)
+	template <typename ROW>
+	std::vector<int8_t>	GetHeight(const TCFIELDT<ROW> &Field)
 	{
 		std::vector<int8_t>	Value;
 		Value.resize(Field.GetSize().GetX());
-		uint32_t	BlockFoundMask = 0;	// 0 means vacant space above.
-		for (int8_t yy = Field.GetSize().GetY() - 2; yy >= 1; yy--) {	// from TOP to BOTTOM
-			uint32_t	Bitmap = Field.GetBitmap(yy) & Field.GetLineFilled() & ~BlockFoundMask;
-			if (Bitmap) {
-				for (int8_t xx = 1; xx < Field.GetSize().GetX() - 1; xx++) {
-					if (Bitmap & TCBIT::Get(xx)) {
-						Value[xx] = yy;
-					}
-				}
-			}
-			BlockFoundMask |= Bitmap;
+		for (int8_t xx = 1; xx < Field.GetSize().GetX() - 1; xx++) {
+			Value[xx] = Field.GetHeight(xx);
 		}
 		return Value;
 
 	} // end of ATU::GetHeight
 
-	std::vector<int8_t>	GetSpotHeight(const TCFIELD &Field)
+	template <typename ROW>
+	std::vector<int8_t>	GetSpotHeight(const TCFIELDT<ROW> &Field)
 	{
 		std::vector<int8_t>	Value;
 		Value.resize(Field.GetSize().GetX());
-		uint32_t	BlockFoundMask = 0;	// 0 means vacant space above.
-		uint32_t	SpotFoundMask = 0;	// 1 means spot found above.
-		uint32_t	Bitmap;
-		for (int8_t yy = Field.GetSize().GetY() - 2; yy >= 1; yy--) {	// from TOP to BOTTOM
-			Bitmap = Field.GetBitmap(yy) & Field.GetLineFilled() & ~SpotFoundMask;
-			if (Bitmap) {
-				for (int8_t xx = 1; xx < Field.GetSize().GetX() - 1; xx++) {
-					if (Bitmap & TCBIT::Get(xx)) {
-						Value[xx]++;
-					}
-				}
-			}
-			BlockFoundMask |= Field.GetBitmap(yy) & Field.GetLineFilled();
-			SpotFoundMask |= ~Field.GetBitmap(yy) & Field.GetLineFilled() & BlockFoundMask;
-		}
-
-		Bitmap = ~SpotFoundMask & Field.GetLineFilled();
-		if (Bitmap) {
-			for (int8_t xx = 1; xx < Field.GetSize().GetX() - 1; xx++) {
-				if (Bitmap & TCBIT::Get(xx)) {
-					Value[xx] = 0;
-				}
+		for (int8_t xx = 1; xx < Field.GetSize().GetX() - 1; xx++) {
+			uint32_t	Column = Field.GetColumn(xx);
+			uint32_t	Holes = ~Column & TCBIT::GetMask(TCBIT::FindHighest(Column));
+			if (Holes) {	// count blocks above the highest spot.
+				Value[xx] = static_cast<int8_t>(TCBIT::Count(Column >> (TCBIT::FindHighest(Holes) + 1)));
 			}
 		}
 		return Value;
 
 	} // end of ATU::GetSpotHeight
 
-	TCPIECE	LimitD(const TCFIELD &Field, const TCPIECE &Piece)
+	template <typename ROW>
+	TCPIECE	LimitD(const TCFIELDT<ROW> &Field, const TCPIECE &Piece)
 	{
 		TCPIECE	Value = Piece;
 		while (Field.IsSetPiece(Value.MoveY(-1))) {
@@ -158,7 +105,8 @@ namespace ATU
 
 	} // end of ATU::LimitD
 
-	TCPIECE	LimitR(const TCFIELD &Field, const TCPIECE &Piece)
+	template <typename ROW>
+	TCPIECE	LimitR(const TCFIELDT<ROW> &Field, const TCPIECE &Piece)
 	{
 		TCPIECE	Value = Piece;
 		while (Field.IsSetPiece(Value.MoveX(-1))) {
@@ -168,7 +116,8 @@ namespace ATU
 
 	} // end of ATU::LimitR
 
-	TCPIECE	LimitL(const TCFIELD &Field, const TCPIECE &Piece)
+	template <typename ROW>
+	TCPIECE	LimitL(const TCFIELDT<ROW> &Field, const TCPIECE &Piece)
 	{
 		TCPIECE	Value = Piece;
 		while (Field.IsSetPiece(Value.MoveX(+1))) {
@@ -178,9 +127,10 @@ namespace ATU
 
 	} // end of ATU::LimitL
 
-	TCFIELD	operator +(const TCFIELD &Field, const TCPIECE &Piece)
+	template <typename ROW>
+	TCFIELDT<ROW>	operator +(const TCFIELDT<ROW> &Field, const TCPIECE &Piece)
 	{
-		TCFIELD	Value = Field;
+		TCFIELDT<ROW>	Value = Field;
 		Value.SetPiece(Piece);
 		return Value;
 
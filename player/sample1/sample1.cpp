@@ -53,8 +53,8 @@ public:
 
 	} // end of SAMPLE1::IsAvailable
 
-	SAMPLE1(const char *strPath, const char *strRule)
-		: TCPLAYER(strPath, strRule),
+	SAMPLE1(const char *strPath, const char *strRule, size_t InstanceId)
+		: TCPLAYER(strPath, strRule, InstanceId),
 		m_SpdX(-1),
 		m_Rot(0)
 	{
@@ -102,6 +102,12 @@ public:
 			((m_SpdX > 0) ? TCEVENT_MOVE_L : 0) |
 			((m_SpdX < 0) ? TCEVENT_MOVE_R : 0);
 	}
+
+	bool	IsStationary() const
+	{
+		// 同じ状況では同じキー入力を返すので、変化のないフレームは省略してもらってかまわない
+		return true;
+	}
 };
 
 TCEXPORT_TCPLAYER(SAMPLE1, "SAMPLE1/0.00", "Abe Chanta")